@@ -10,11 +10,258 @@
 
 #include "defs.h"
 #include "stdio.h"
+#include "string.h"
 
-const int KnDir[8] = {-8, -19, -21, -12, 8, 19, 21, 12};
-const int RkDir[4] = {-1, -10, 1, 10};
-const int BiDir[4] = {-9, -11, 11, 9};
-const int KiDir[8] = {-1, -10,	1, 10, -9, -11, 11, 9};
+U64 KnightAttacks[BRD_SQUARES];
+U64 KingAttacks[BRD_SQUARES];
+U64 PawnAttacks[2][BRD_SQUARES];
+S_MAGIC BishopMagics[BRD_SQUARES];
+S_MAGIC RookMagics[BRD_SQUARES];
+U64 BetweenBB[BRD_SQUARES][BRD_SQUARES];
+U64 LineBB[BRD_SQUARES][BRD_SQUARES];
+
+/**
+  * Attack tables of all the squares, sized by the sum of 2^(bits in the mask) over the squares
+  */
+static U64 BishopTable[5248];
+static U64 RookTable[102400];
+
+// File and rank steps of the pieces
+static const int KnightSteps[8][2] = { {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2} };
+static const int KingSteps[8][2] = { {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1} };
+static const int BishopSteps[4][2] = { {1, 1}, {1, -1}, {-1, 1}, {-1, -1} };
+static const int RookSteps[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+
+/**
+  * @brief Function to get the squares a step away from a square
+  *
+  * @param sq64 64 based square
+  * @param steps File and rank steps
+  * @param numSteps Number of steps
+  * @return Bit Board of the target squares on the board
+  */
+static U64 StepAttacks(const int sq64, const int steps[][2], const int numSteps) {
+
+	int index = 0;
+	int file = 0;
+	int rank = 0;
+	U64 attacks = 0ULL;
+
+	for(index = 0; index < numSteps; ++index) {
+		file = FILEINDEX_64(sq64) + steps[index][0];
+		rank = RANKINDEX_64(sq64) + steps[index][1];
+
+		if(file >= FILE_A && file <= FILE_H && rank >= RANK_1 && rank <= RANK_8) {
+			SETBIT(attacks, SQINDEX_64(file, rank));
+		}
+	}
+
+	return attacks;
+}
+
+/**
+  * @brief Function to get the attacks of a slider by walking its rays, used to fill the magic tables
+  *
+  * @param sq64 64 based square
+  * @param occ Occupancy of the board
+  * @param steps File and rank steps of the four directions
+  * @return Bit Board of the attacked squares, up to and including the first occupied square on each ray
+  */
+static U64 SlidingAttacks(const int sq64, const U64 occ, const int steps[4][2]) {
+
+	int index = 0;
+	int file = 0;
+	int rank = 0;
+	U64 attacks = 0ULL;
+
+	for(index = 0; index < 4; ++index) {
+		file = FILEINDEX_64(sq64) + steps[index][0];
+		rank = RANKINDEX_64(sq64) + steps[index][1];
+
+		while(file >= FILE_A && file <= FILE_H && rank >= RANK_1 && rank <= RANK_8) {
+			SETBIT(attacks, SQINDEX_64(file, rank));
+
+			if(IS_SET_64(occ, SQINDEX_64(file, rank))) {
+				break;
+			}
+
+			file += steps[index][0];
+			rank += steps[index][1];
+		}
+	}
+
+	return attacks;
+}
+
+/**
+  * @brief Function to get a pseudo random number (xorshift64*) for the magic search
+  *
+  * @param *seed Pointer to the state of the generator
+  */
+static U64 RandomU64(U64 *seed) {
+	*seed ^= *seed >> 12;
+	*seed ^= *seed << 25;
+	*seed ^= *seed >> 27;
+
+	return *seed * C64(2685821657736338717);
+}
+
+/**
+  * @brief Function to find the magic numbers of a slider and fill its attack tables
+  * Every subset of the mask is hashed; a candidate magic is accepted when no two subsets with
+  * different attacks share an index. Candidates are random numbers with few bits set.
+  *
+  * @param magics Magic bitboards of the slider
+  * @param *table Attack table of the slider
+  * @param steps File and rank steps of the slider's directions
+  */
+static void InitMagics(S_MAGIC magics[], U64 *table, const int steps[4][2]) {
+
+	static U64 occupancy[4096];
+	static U64 reference[4096];
+	static int epoch[4096];
+
+	int attempt = 0;
+	int sq64 = 0;
+	int size = 0;
+	int index = 0;
+	int found = FALSE;
+	U64 subset = 0ULL;
+	U64 edges = 0ULL;
+	U64 seed = C64(0x9E3779B97F4A7C15);
+	unsigned int key = 0;
+	S_MAGIC *magic = NULL;
+
+	memset(epoch, 0, sizeof(epoch));
+
+	for(sq64 = 0; sq64 < BRD_SQUARES; ++sq64) {
+		magic = &magics[sq64];
+
+		// The edges don't change the attacks, unless the slider is on them
+		edges = ((FIRST_RANK_64 | EIGHT_RANK_64) & ~((U64) FIRST_RANK_64 << (8 * RANKINDEX_64(sq64))))
+              | ((A_FILE_64 | H_FILE_64) & ~(A_FILE_64 << FILEINDEX_64(sq64)));
+
+		magic->mask = SlidingAttacks(sq64, 0ULL, steps) & ~edges;
+		magic->shift = 64 - CNT(magic->mask);
+		magic->attacks = table;
+
+		// Enumerate all subsets of the mask (Carry-Rippler) with their attacks
+		size = 0;
+		subset = 0ULL;
+
+		do {
+			occupancy[size] = subset;
+			reference[size] = SlidingAttacks(sq64, subset, steps);
+			size++;
+			subset = (subset - magic->mask) & magic->mask;
+		} while(subset);
+
+		// Try magics until every subset hashes without a destructive collision
+		do {
+			do {
+				magic->magic = RandomU64(&seed) & RandomU64(&seed) & RandomU64(&seed);
+			} while(CNT((magic->mask * magic->magic) >> 56) < 6);
+
+			// The epoch marks the table entries written by the current attempt
+			attempt++;
+			found = TRUE;
+
+			for(index = 0; index < size; ++index) {
+				key = (unsigned int) ((occupancy[index] * magic->magic) >> magic->shift);
+
+				if(epoch[key] < attempt) {
+					epoch[key] = attempt;
+					magic->attacks[key] = reference[index];
+				} else if(magic->attacks[key] != reference[index]) {
+					found = FALSE;
+					break;
+				}
+			}
+		} while(found == FALSE);
+
+		table += size;
+	}
+}
+
+/**
+  * @brief Function to initialize the squares between and the lines through two aligned squares
+  */
+static void InitLines() {
+
+	int sq1 = 0;
+	int sq2 = 0;
+	U64 bb1 = 0ULL;
+	U64 bb2 = 0ULL;
+
+	for(sq1 = 0; sq1 < BRD_SQUARES; ++sq1) {
+		for(sq2 = 0; sq2 < BRD_SQUARES; ++sq2) {
+			BetweenBB[sq1][sq2] = 0ULL;
+			LineBB[sq1][sq2] = 0ULL;
+
+			if(sq1 == sq2) {
+				continue;
+			}
+
+			bb1 = SetMask[sq1];
+			bb2 = SetMask[sq2];
+
+			// The attacks of both squares on an empty board overlap along the line, and between them
+			// when each square blocks the other
+			if(BISHOP_ATTACKS(sq1, 0ULL) & bb2) {
+				LineBB[sq1][sq2] = (BISHOP_ATTACKS(sq1, 0ULL) & BISHOP_ATTACKS(sq2, 0ULL)) | bb1 | bb2;
+				BetweenBB[sq1][sq2] = BISHOP_ATTACKS(sq1, bb2) & BISHOP_ATTACKS(sq2, bb1);
+			} else if(ROOK_ATTACKS(sq1, 0ULL) & bb2) {
+				LineBB[sq1][sq2] = (ROOK_ATTACKS(sq1, 0ULL) & ROOK_ATTACKS(sq2, 0ULL)) | bb1 | bb2;
+				BetweenBB[sq1][sq2] = ROOK_ATTACKS(sq1, bb2) & ROOK_ATTACKS(sq2, bb1);
+			}
+		}
+	}
+}
+
+/**
+  * @brief Function to initialize the attack tables of all pieces
+  */
+void InitAttacks() {
+
+	int sq64 = 0;
+	const int whitePawnSteps[2][2] = { {-1, 1}, {1, 1} };
+	const int blackPawnSteps[2][2] = { {-1, -1}, {1, -1} };
+
+	for(sq64 = 0; sq64 < BRD_SQUARES; ++sq64) {
+		KnightAttacks[sq64] = StepAttacks(sq64, KnightSteps, 8);
+		KingAttacks[sq64] = StepAttacks(sq64, KingSteps, 8);
+		PawnAttacks[WHITE][sq64] = StepAttacks(sq64, whitePawnSteps, 2);
+		PawnAttacks[BLACK][sq64] = StepAttacks(sq64, blackPawnSteps, 2);
+	}
+
+	InitMagics(BishopMagics, BishopTable, BishopSteps);
+	InitMagics(RookMagics, RookTable, RookSteps);
+
+	InitLines();
+}
+
+/**
+  * @brief Function to get the attacks of a piece other than a pawn
+  *
+  * @param pce The piece
+  * @param sq64 64 based square the piece is on
+  * @param occ Occupancy of the board
+  * @return Bit Board of the attacked squares
+  */
+U64 AttacksFrom(const int pce, const int sq64, const U64 occ) {
+
+	ASSERT(PieceValid(pce) && !PiecePawn[pce]);
+
+	if(IsKn(pce)) {
+		return KnightAttacks[sq64];
+	}
+
+	if(IsKi(pce)) {
+		return KingAttacks[sq64];
+	}
+
+	return (IsBQ(pce) ? BISHOP_ATTACKS(sq64, occ) : 0ULL) | (IsRQ(pce) ? ROOK_ATTACKS(sq64, occ) : 0ULL);
+}
 
 /**
   * @brief Function to check is a square is attacked by a side
@@ -25,80 +272,156 @@ const int KiDir[8] = {-1, -10,	1, 10, -9, -11, 11, 9};
   */
 int SqAttacked(const int sq, const int side, const S_BOARD *pos) {
 
-	int pce, index, t_sq, dir;
+	int sq64 = SQ64(sq);
+	U64 occ = pos->occupancy[BOTH];
 
     ASSERT(SqOnBoard(sq));
 	ASSERT(SideValid(side));
 	ASSERT(CheckBoard(pos));
 
-	// Pawns
-	if(side == WHITE) {
-		if(pos->pieces[sq - 11] == wP || pos->pieces[sq - 9] == wP) {
-			return TRUE;
-		}
-	} else {
-		if(pos->pieces[sq + 11] == bP || pos->pieces[sq + 9] == bP) {
-			return TRUE;
-		}
+	// Pawns: the square is attacked by a pawn standing where a pawn of the other side on the square would attack
+	if(PawnAttacks[side ^ 1][sq64] & pos->pieceBB[SIDE_PCE(wP, side)]) {
+		return TRUE;
 	}
 
     // Knights
-	for(index = 0; index < 8; ++index) {
-		pce = pos->pieces[sq + KnDir[index]];
-		if(pce != OFFBOARD && pce != EMPTY && IsKn(pce) && PieceCol[pce]==side) {
-			return TRUE;
-		}
+	if(KnightAttacks[sq64] & pos->pieceBB[SIDE_PCE(wN, side)]) {
+		return TRUE;
+	}
+
+	// Bishops or Queens
+	if(BISHOP_ATTACKS(sq64, occ) & (pos->pieceBB[SIDE_PCE(wB, side)] | pos->pieceBB[SIDE_PCE(wQ, side)])) {
+		return TRUE;
 	}
 
 	// Rooks or Queens
-	for(index = 0; index < 4; ++index) {
-		dir = RkDir[index];
-		t_sq = sq + dir;
-		pce = pos->pieces[t_sq];
-
-		// Go until it goes off-board or hits a piece
-		while(pce != OFFBOARD) {
-			if(pce != EMPTY) {
-				if(IsRQ(pce) && PieceCol[pce] == side) {
-					return TRUE;
-				}
-				break;
-			}
+	if(ROOK_ATTACKS(sq64, occ) & (pos->pieceBB[SIDE_PCE(wR, side)] | pos->pieceBB[SIDE_PCE(wQ, side)])) {
+		return TRUE;
+	}
 
-			t_sq += dir;
-			pce = pos->pieces[t_sq];
-		}
+	// Kings
+	if(KingAttacks[sq64] & pos->pieceBB[SIDE_PCE(wK, side)]) {
+		return TRUE;
 	}
 
-    // Bishops or Queens
-	for(index = 0; index < 4; ++index) {
-		dir = BiDir[index];
-		t_sq = sq + dir;
-		pce = pos->pieces[t_sq];
-
-        // Go until it goes off-board or hits a piece
-		while(pce != OFFBOARD) {
-			if(pce != EMPTY) {
-				if(IsBQ(pce) && PieceCol[pce] == side) {
-					return TRUE;
-				}
+	return FALSE;
+}
+
+/**
+  * @brief Function to get all pieces of both sides attacking a square
+  *
+  * @param *pos Pointer to the board structure
+  * @param sq64 64 based square which is attacked
+  * @param occ Occupancy of the board, sliders see through the squares not in it
+  * @return Bit Board of the attackers, including pieces no longer in the occupancy
+  */
+U64 AttackersTo(const S_BOARD *pos, const int sq64, const U64 occ) {
+	return (PawnAttacks[BLACK][sq64] & pos->pieceBB[wP])
+         | (PawnAttacks[WHITE][sq64] & pos->pieceBB[bP])
+         | (KnightAttacks[sq64] & (pos->pieceBB[wN] | pos->pieceBB[bN]))
+         | (KingAttacks[sq64] & (pos->pieceBB[wK] | pos->pieceBB[bK]))
+         | (BISHOP_ATTACKS(sq64, occ) & (pos->pieceBB[wB] | pos->pieceBB[bB] | pos->pieceBB[wQ] | pos->pieceBB[bQ]))
+         | (ROOK_ATTACKS(sq64, occ) & (pos->pieceBB[wR] | pos->pieceBB[bR] | pos->pieceBB[wQ] | pos->pieceBB[bQ]));
+}
+
+/**
+  * @brief Function for Static Exchange Evaluation of a move
+  * Static Exchange Evaluation in Chess Programming Wiki: https://www.chessprogramming.org/Static_Exchange_Evaluation
+  *
+  * @param *pos Pointer to the board structure
+  * @param move The move, usually a capture
+  * @return Material won by the side to move after the exchanges on the to square, negative if it loses material
+  *
+  * Both sides recapture with their least valuable attacker and may stop exchanging when it doesn't pay.
+  * Attackers are removed from the occupancy as they capture, so sliders behind them join in (x-rays).
+  * Pins are ignored; a king only recaptures when the square is no longer attacked.
+  */
+int StaticExchangeEval(const S_BOARD *pos, const int move) {
+
+	int gain[32];
+	int from64 = SQ64(FROMSQ(move));
+	int to64 = SQ64(TOSQ(move));
+	int side = pos->side;
+	int depth = 0;
+	int pce = EMPTY;
+	int onTo = EMPTY;
+	U64 occ = pos->occupancy[BOTH];
+	U64 attackers = 0ULL;
+	U64 sideAttackers = 0ULL;
+	U64 bb = 0ULL;
+
+	ASSERT(SqOnBoard(FROMSQ(move)));
+	ASSERT(SqOnBoard(TOSQ(move)));
+	ASSERT(CheckBoard(pos));
+
+	// Castling never exchanges material
+	if(move & MFLAGCA) {
+		return 0;
+	}
+
+	// Win the captured piece, removing an en passant pawn from its own square
+	if(move & MFLAGEP) {
+		gain[0] = PieceVal[wP];
+		CLRBIT(occ, (side == WHITE) ? to64 - 8 : to64 + 8);
+	} else {
+		gain[0] = PieceVal[pos->pieces[SQ120(to64)]];
+	}
+
+	// The moved piece now stands on the to square, promoted if it's a promotion
+	onTo = pos->pieces[SQ120(from64)];
+
+	if(PROMOTED(move) != EMPTY) {
+		gain[0] += PieceVal[PROMOTED(move)] - PieceVal[wP];
+		onTo = PROMOTED(move);
+	}
+
+	CLRBIT(occ, from64);
+	attackers = AttackersTo(pos, to64, occ) & occ;
+
+	// Alternately recapture with the least valuable attacker
+	while(depth < 31) {
+		side ^= 1;
+		sideAttackers = attackers & pos->occupancy[side];
+
+		if(!sideAttackers) {
+			break;
+		}
+
+		for(pce = SIDE_PCE(wP, side); pce <= SIDE_PCE(wK, side); ++pce) {
+			bb = sideAttackers & pos->pieceBB[pce];
+
+			if(bb) {
 				break;
 			}
+		}
 
-			t_sq += dir;
-			pce = pos->pieces[t_sq];
+		depth++;
+		// Speculative score if the piece on the to square is captured and not recaptured
+		gain[depth] = PieceVal[onTo] - gain[depth - 1];
+		onTo = pce;
+
+		// A king can't recapture onto a square the other side still attacks, and ends the exchange
+		if(IsKi(pce)) {
+			if(attackers & pos->occupancy[side ^ 1]) {
+				depth--;
+			}
+			break;
 		}
+
+		// Remove the attacker and add the sliders behind it
+		occ ^= LS1B_64(bb);
+		attackers |= (BISHOP_ATTACKS(to64, occ) & (pos->pieceBB[wB] | pos->pieceBB[bB] | pos->pieceBB[wQ] | pos->pieceBB[bQ]))
+                   | (ROOK_ATTACKS(to64, occ) & (pos->pieceBB[wR] | pos->pieceBB[bR] | pos->pieceBB[wQ] | pos->pieceBB[bQ]));
+		attackers &= occ;
 	}
 
-	// Kings
-	for(index = 0; index < 8; ++index) {
-		pce = pos->pieces[sq + KiDir[index]];
-		if(pce != OFFBOARD && pce != EMPTY && IsKi(pce) && PieceCol[pce]==side) {
-			return TRUE;
-		}
+	// Negamax the gains back: each side may stand pat instead of capturing
+	while(depth > 0) {
+		gain[depth - 1] = -MAX(-gain[depth - 1], gain[depth]);
+		depth--;
 	}
 
-	return FALSE;
+	return gain[0];
 }
 
 #endif // ATTACK_C
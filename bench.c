@@ -0,0 +1,106 @@
+/***********************************************************
+  * File Name: bench.c
+  * Author: Somnath Mukherjee
+  * Description:
+  * Deterministic search benchmark
+  **********************************************************/
+
+#ifndef BENCH_C
+#define BENCH_C
+
+#include "defs.h"
+#include "stdio.h"
+
+/**
+  * Positions of the bench: openings, middle games with both sides castled, tactical positions and endgames
+  */
+static const char *BenchFens[] = {
+    START_FEN,
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - 0 1",
+    "r1bq1rk1/pp2ppbp/2np1np1/8/3NP3/2N1BP2/PPPQ2PP/R3KB1R w KQ - 3 9",
+    "r1bqkb1r/pp3ppp/2n1pn2/2pp4/3P4/2PBPN2/PP3PPP/RNBQK2R w KQkq - 0 6",
+    "3r1rk1/p4ppp/1qp1b3/4P3/2Q1n3/2N1B3/PP3PPP/R4RK1 w - - 0 18",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+    "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+    "8/8/1p4p1/p1p2k1p/P2n1P1P/1P2K1P1/4N3/8 w - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1"
+};
+
+/**
+  * Function to run the bench: searches the bench positions to a fixed depth with a single thread,
+  * clearing the Hash Table before each position and without listening to the protocol.
+  * The threads, the Hash Table size and the game mode of the session are restored afterwards.
+  * The total node count is a signature of the search, it only changes when the search does.
+  *
+  * @param *pos Pointer to the board structure
+  * @param *info Pointer to the search info
+  * @param depth Depth to search each position to
+  * @param MB Size of the Hash Table in MB
+  */
+void Bench(S_BOARD *pos, S_SEARCHINFO *info, const int depth, const int MB) {
+
+	int posNum = 0;
+	int posCount = (int) (sizeof(BenchFens) / sizeof(BenchFens[0]));
+	U64 startTime = 0ULL;
+	int time = 0;
+	int totalTime = 0;
+	U64 totalNodes = 0ULL;
+	// Settings of the session, put back after the bench
+	int threadNum = info->threadNum;
+	int gameMode = info->GAME_MODE;
+	int hashMB = (int) ((U64) pos->HashTable->numBuckets * sizeof(S_HASHBUCKET) / 0x100000);
+	int benchMB = MIN(MAX(MB, HASH_MIN_MB), HASH_MAX_MB);
+
+	// The node count is only reproducible with one thread
+	SetSearchThreads(info, 1);
+
+	if(benchMB != hashMB) {
+		InitHashTable(pos->HashTable, benchMB);
+	}
+
+	info->GAME_MODE = UCIMODE;
+	info->ignoreInput = TRUE;
+
+	for(posNum = 0; posNum < posCount; ++posNum) {
+		printf("\nPosition %d/%d: %s\n", posNum + 1, posCount, BenchFens[posNum]);
+
+		ParseFen((char *) BenchFens[posNum], pos);
+		ClearHashTable(pos->HashTable);
+
+		info->depth = MIN(MAX(depth, 1), MAXDEPTH - 1);
+		info->timeset = FALSE;
+		info->quit = FALSE;
+
+		startTime = GetTimeMs();
+		info->starttime = startTime;
+
+		SearchPosition(pos, info);
+
+		time = (int) (GetTimeMs() - startTime);
+		totalTime += time;
+		totalNodes += info->nodes;
+	}
+
+	info->ignoreInput = FALSE;
+	info->GAME_MODE = gameMode;
+	SetSearchThreads(info, threadNum);
+
+	// The bench cleared the Hash Table anyway, it's only resized back
+	if(benchMB != hashMB) {
+		InitHashTable(pos->HashTable, hashMB);
+	}
+
+	printf("\n===========================\n");
+	printf("Total time (ms) : %d\n", totalTime);
+	printf("Nodes searched  : %llu\n", totalNodes);
+	printf("Nodes/second    : %llu\n", totalNodes * 1000 / (U64) MAX(totalTime, 1));
+}
+
+#endif // BENCH_C
@@ -24,6 +24,8 @@ int CheckBoard(const S_BOARD *pos) {
 	int t_majPce[2] = {0, 0};
 	int t_minPce[2] = {0, 0};
 	int t_material[2] = {0, 0};
+	int t_pstMg = 0;
+	int t_pstEg = 0;
 
 	int sq64,t_piece,t_pce_num,sq120,colour,pcount;
 
@@ -60,8 +62,10 @@ int CheckBoard(const S_BOARD *pos) {
 		if(PieceMin[t_piece] == TRUE) t_minPce[colour]++;
 		if(PieceMaj[t_piece] == TRUE) t_majPce[colour]++;
 
-        // Update the material value
+        // Update the material value and the piece-square scores
 		t_material[colour] += PieceVal[t_piece];
+		t_pstMg += PstMg[t_piece][sq64];
+		t_pstEg += PstEg[t_piece][sq64];
 	}
 
     // Validate each piece type
@@ -95,8 +99,28 @@ int CheckBoard(const S_BOARD *pos) {
 		ASSERT((pos->pieces[SQ120(sq64)] == bP) || (pos->pieces[SQ120(sq64)] == wP));
 	}
 
+	// Check the piece Bit Boards against the piece count and squares, and the occupancy against them
+	U64 t_occupancy[3] = {0ULL, 0ULL, 0ULL};
+	U64 t_bb = 0ULL;
+
+	for(t_piece = wP; t_piece <= bK; ++t_piece) {
+		ASSERT(CNT(pos->pieceBB[t_piece]) == pos->pceNum[t_piece]);
+		t_occupancy[PieceCol[t_piece]] |= pos->pieceBB[t_piece];
+		t_bb = pos->pieceBB[t_piece];
+
+		while(t_bb) {
+			sq64 = POP(&t_bb);
+			ASSERT(pos->pieces[SQ120(sq64)] == t_piece);
+		}
+	}
+
+	t_occupancy[BOTH] = t_occupancy[WHITE] | t_occupancy[BLACK];
+	ASSERT(t_occupancy[WHITE] == pos->occupancy[WHITE] && t_occupancy[BLACK] == pos->occupancy[BLACK]);
+	ASSERT(t_occupancy[BOTH] == pos->occupancy[BOTH]);
+
     // Validate material, minor pieces, major pieces, big pieces
 	ASSERT(t_material[WHITE]==pos->material[WHITE] && t_material[BLACK]==pos->material[BLACK]);
+	ASSERT(t_pstMg==pos->pstMg && t_pstEg==pos->pstEg);
 	ASSERT(t_minPce[WHITE]==pos->minPce[WHITE] && t_minPce[BLACK]==pos->minPce[BLACK]);
 	ASSERT(t_majPce[WHITE]==pos->majPce[WHITE] && t_majPce[BLACK]==pos->majPce[BLACK]);
 	ASSERT(t_bigPce[WHITE]==pos->bigPce[WHITE] && t_bigPce[BLACK]==pos->bigPce[BLACK]);
@@ -104,6 +128,8 @@ int CheckBoard(const S_BOARD *pos) {
     // Validate side to move and position key
 	ASSERT(pos->side==WHITE || pos->side==BLACK);
 	ASSERT(GeneratePosKey(pos)==pos->posKey);
+	ASSERT(GeneratePawnKey(pos)==pos->pawnKey);
+	ASSERT(GenerateMaterialKey(pos)==pos->materialKey);
 
     // Validate en passant
 	ASSERT(pos->enPas==NO_SQ || ( RanksBrd[pos->enPas]==RANK_6 && pos->side == WHITE)
@@ -144,14 +170,20 @@ void ResetBoard(S_BOARD *pos) {
         pos->material[index] = 0;
     }
 
-    // Reset the pawns
+    // Reset the piece-square scores
+    pos->pstMg = 0;
+    pos->pstEg = 0;
+
+    // Reset the pawns and the occupancy
     for(index = 0 ; index < NUM_COLORS ; ++index) {
         pos->pawns[index] = 0ULL;
+        pos->occupancy[index] = 0ULL;
     }
 
-    // Set the number of pieces to zero
+    // Set the number of pieces to zero and clear their Bit Boards
     for(index = 0 ; index < NUM_PIECES ; ++index) {
         pos->pceNum[index] = 0;
+        pos->pieceBB[index] = 0ULL;
     }
 
     // Set the king's square for both sides to no square
@@ -172,8 +204,10 @@ void ResetBoard(S_BOARD *pos) {
     // Reset castle permissions
     pos->castlePerm = 0;
 
-    // Reset position key/hash key
+    // Reset position key/hash key and pawn key
     pos->posKey = 0ULL;
+    pos->pawnKey = 0ULL;
+    pos->materialKey = 0ULL;
 }
 
 /**
@@ -182,9 +216,15 @@ void ResetBoard(S_BOARD *pos) {
   * @param *pos Board Position
   */
 void InitializeBoard(S_BOARD *board) {
-    board->PvTable->pTable = NULL;
-    // Initialize Principal Variation table
-	InitPvTable(board->PvTable);
+    // Use the shared Hash table
+	board->HashTable = HashTable;
+	// Allocate the pawn and material Hash Tables of the board; without them, the evaluation doesn't cache
+	board->PawnTable = (S_PAWNTABLE *) calloc(1, sizeof(S_PAWNTABLE));
+	board->MaterialTable = (S_MATERIALTABLE *) calloc(1, sizeof(S_MATERIALTABLE));
+	// Allocate the evaluation cache of the board
+	board->EvalTable = (S_EVALTABLE *) calloc(1, sizeof(S_EVALTABLE));
+	// Allocate the NNUE accumulators, one for each position of the game
+	board->Accumulators = (S_ACCUMULATOR *) calloc(MAXGAMEMOVES, sizeof(S_ACCUMULATOR));
 }
 
 /**
@@ -193,7 +233,15 @@ void InitializeBoard(S_BOARD *board) {
   * @param *pos Board Position
   */
 void ClearBoard(S_BOARD *board) {
-    free(board->PvTable->pTable);
+    board->HashTable = NULL;
+    free(board->PawnTable);
+    board->PawnTable = NULL;
+    free(board->MaterialTable);
+    board->MaterialTable = NULL;
+    free(board->EvalTable);
+    board->EvalTable = NULL;
+    free(board->Accumulators);
+    board->Accumulators = NULL;
 }
 
 /**
@@ -338,9 +386,17 @@ int ParseFen(char *fen, S_BOARD *pos) {
 
     // Generate the position key / hash key
     pos->posKey = GeneratePosKey(pos);
+    pos->pawnKey = GeneratePawnKey(pos);
 
     // Update the material list
     UpdateListsMaterial(pos);
+    // Generate the material key from the piece counts
+    pos->materialKey = GenerateMaterialKey(pos);
+
+    // The NNUE accumulator of the new position is computed from scratch when it's evaluated
+    if(pos->Accumulators != NULL) {
+        NnueReset(pos);
+    }
 
     return 0;
 }
@@ -469,11 +525,18 @@ void UpdateListsMaterial(S_BOARD *pos) {
 		    }
 
 			pos->material[colour] += PieceVal[piece];
+			pos->pstMg += PstMg[piece][SQ64(sq)];
+			pos->pstEg += PstEg[piece][SQ64(sq)];
 
 			// Piece List
 			pos->pList[piece][pos->pceNum[piece]] = sq;
 			pos->pceNum[piece]++;
 
+			// Piece and occupancy Bit Boards
+			SETBIT(pos->pieceBB[piece], SQ64(sq));
+			SETBIT(pos->occupancy[colour], SQ64(sq));
+			SETBIT(pos->occupancy[BOTH], SQ64(sq));
+
             // Set King Position
 			if(piece==wK) {
                     pos->kingSq[WHITE] = sq;
@@ -20,6 +20,7 @@ int PieceBig[NUM_PIECES] = { FALSE, FALSE, TRUE, TRUE, TRUE, TRUE, TRUE, FALSE,
 int PieceMaj[NUM_PIECES] = { FALSE, FALSE, FALSE, FALSE, TRUE, TRUE, TRUE, FALSE, FALSE, FALSE, TRUE, TRUE, TRUE };
 int PieceMin[NUM_PIECES] = { FALSE, FALSE, TRUE, TRUE, FALSE, FALSE, FALSE, FALSE, TRUE, TRUE, FALSE, FALSE, FALSE };
 int PieceVal[NUM_PIECES] = { 0, 100, 325, 325, 550, 1000, 50000, 100, 325, 325, 550, 1000, 50000 };
+int PiecePhase[NUM_PIECES] = { 0, 0, 1, 1, 2, 4, 0, 0, 1, 1, 2, 4, 0 };
 int PieceCol[NUM_PIECES] = { BOTH, WHITE, WHITE, WHITE, WHITE, WHITE, WHITE, BLACK, BLACK, BLACK, BLACK, BLACK, BLACK };
 
 int PiecePawn[NUM_PIECES] = { FALSE, TRUE, FALSE, FALSE, FALSE, FALSE, FALSE, TRUE, FALSE, FALSE, FALSE, FALSE, FALSE };
@@ -9,6 +9,8 @@
 #define DEFS_H
 
 #include "stdlib.h"
+#include "pthread.h"
+#include "stdint.h"
 
 // Define DEBUG. Comment in release mode
 //#define DEBUG
@@ -65,6 +67,59 @@ typedef unsigned long long U64;
   */
 #define MAXDEPTH 64
 
+/**
+  * Maximum number of search threads
+  */
+#define MAX_THREADS 256
+
+/**
+  * Maximum number of lines of the MultiPV analysis
+  */
+#define MAX_MULTIPV 64
+
+/**
+  * Score bound used as infinity by the search
+  */
+#define INFINITE 30000
+
+/**
+  * Score of a checkmate at the root; a mate in n plies scores MATE - n
+  */
+#define MATE 29000
+
+/**
+  * Any score beyond this is a mate score
+  */
+#define ISMATE (MATE - MAXDEPTH)
+
+/**
+  * Default, minimum and maximum size of the Hash Table in MB
+  */
+#define HASH_DEFAULT_MB 16
+#define HASH_MIN_MB 1
+#define HASH_MAX_MB 131072
+
+/**
+  * Game phase of the starting position: the sum of PiecePhase over all pieces. Falls to 0 with only pawns and kings
+  */
+#define TOTAL_PHASE 24
+
+/**
+  * Default depth of the bench
+  */
+#define BENCH_DEPTH 10
+
+/**
+  * Size of the perft Hash Table in MB
+  */
+#define PERFT_HASH_MB 64
+
+/**
+  * Number of lines the input queue holds, and the longest line
+  */
+#define INPUT_QUEUE_SIZE 64
+#define INPUT_LINE_SIZE 8192
+
 /**
   * Start FEN Position
   */
@@ -98,6 +153,14 @@ typedef unsigned long long U64;
   * Little endian 64 based rank-file (LERF) constant for First Rank
   */
 #define FIRST_RANK_64 0x00000000000000FF
+/**
+  * Little endian 64 based rank-file (LERF) constant for Third Rank
+  */
+#define THIRD_RANK_64 0x0000000000FF0000
+/**
+  * Little endian 64 based rank-file (LERF) constant for Sixth Rank
+  */
+#define SIXTH_RANK_64 0x0000FF0000000000
 /**
   * Little endian 64 based rank-file (LERF) constant for Eight Rank
   */
@@ -238,20 +301,247 @@ typedef struct {
 } S_MOVELIST;
 
 /**
-  * Structure for Principal Variation Table entry
+  * Structure for the check and pin information of the side to move, used to generate only legal moves
+  */
+typedef struct {
+	// 64 based square of the king
+	int kingSq64;
+
+	/**
+	  * Enemy pieces giving check and own pieces pinned to the king
+	  */
+	U64 checkers;
+	U64 pinned;
+
+	/**
+	  * Squares a piece other than the king must move to: all squares when not in check,
+	  * otherwise the checker and the squares between it and the king
+	  */
+	U64 checkMask;
+} S_CHECKINFO;
+
+/**
+  * Stages of the move picker
+  */
+enum {
+    PICK_HASH, /**< Move from the Hash Table */
+    PICK_GEN_CAPTURES, /**< Generate the captures */
+    PICK_GOOD_CAPTURES, /**< Captures that don't lose material, by MVV-LVA */
+    PICK_KILLER_1, /**< First killer move */
+    PICK_KILLER_2, /**< Second killer move */
+    PICK_BAD_CAPTURES, /**< Captures that lose material by Static Exchange Evaluation */
+    PICK_GEN_QUIETS, /**< Generate and sort the quiet moves */
+    PICK_QUIETS, /**< Quiet moves by search history */
+    PICK_DONE /**< No moves left */
+};
+
+/**
+  * Structure for the staged move picker
+  */
+typedef struct {
+    /**
+      * Current stage
+      */
+	int stage;
+
+	/**
+	  * If set to true, only the hash move and the good captures are picked
+	  */
+	int capturesOnly;
+
+	int hashMove;
+	int killers[2];
+
+	/**
+	  * Captures and quiet moves, each generated when its stage is reached
+	  */
+	S_MOVELIST captures[1];
+	S_MOVELIST quiets[1];
+
+	/**
+	  * Index of the next capture and the next quiet move
+	  */
+	int captureIndex;
+	int quietIndex;
+
+	// Checks and pins of the position, shared by all stages
+	S_CHECKINFO checkInfo[1];
+} S_MOVEPICKER;
+
+/**
+  * Enumeration for Hash Table entry flags - the bound type of the stored score
+  */
+enum {
+    HFNONE, /**< 0 - No score stored */
+    HFALPHA, /**< 1 - Upper bound, the search failed low */
+    HFBETA, /**< 2 - Lower bound, the search failed high */
+    HFEXACT /**< 3 - Exact score */
+};
+
+/**
+  * Number of entries in a Hash Table bucket
+  */
+#define HASH_BUCKET_SIZE 4
+
+/**
+  * Structure for Hash Table (Transposition Table) entry, packed into 16 bytes
+  */
+typedef struct {
+	/**
+      * Position key XOR data. Verifies the entry without locking it, see FindHashEntry
+      */
+	U64 smpKey;
+	/**
+      * Move, score, depth, flags and age packed into 64 bits
+      */
+	U64 data;
+} S_HASHENTRY;
+
+/**
+  * Structure for Hash Table bucket. One cache line holding HASH_BUCKET_SIZE entries
+  */
+typedef struct {
+	S_HASHENTRY entries[HASH_BUCKET_SIZE];
+} S_HASHBUCKET;
+
+/**
+  * Structure for Hash Table (Transposition Table)
+  */
+typedef struct {
+	/**
+      * Buckets, aligned to 64 bytes
+      */
+	S_HASHBUCKET *pTable;
+	/**
+      * Memory block as allocated, pTable points into it
+      */
+	void *mem;
+	unsigned int numBuckets;
+	/**
+      * Age of the current search. Entries from older searches are replaced first
+      */
+	int age;
+} S_HASHTABLE;
+
+/**
+  * Number of entries in a pawn Hash Table, a power of two
+  */
+#define PAWN_HASH_SIZE 65536
+
+/**
+  * Structure for pawn Hash Table entry: the pawn structure scores of a pawn key, from White's side
+  */
+typedef struct {
+	U64 pawnKey;
+	int mg;
+	int eg;
+} S_PAWNENTRY;
+
+/**
+  * Structure for pawn Hash Table. Each search thread has its own, so it needs no locking
+  */
+typedef struct {
+	S_PAWNENTRY entries[PAWN_HASH_SIZE];
+} S_PAWNTABLE;
+
+/**
+  * Specialised evaluation of a material combination
+  */
+enum {
+    ENDGAME_NONE, /**< Normal evaluation */
+    ENDGAME_DRAW, /**< Dead draw, neither side can mate */
+    ENDGAME_KBNK, /**< King, Bishop and Knight against the bare King: drive the King to the Bishop's corner */
+    ENDGAME_BISHOPS, /**< A Bishop each and pawns: drawish if the Bishops are on opposite colours */
+    ENDGAME_BISHOPS_ONLY /**< Only Bishops besides the Kings: a dead draw if they all stand on one colour */
+};
+
+/**
+  * Scale factor of the evaluation for a side that is ahead: SCALE_NORMAL keeps its score,
+  * 0 makes it a draw
+  */
+#define SCALE_NORMAL 16
+
+/**
+  * Number of entries in a material Hash Table, a power of two
+  */
+#define MATERIAL_HASH_SIZE 8192
+
+/**
+  * Structure for material Hash Table entry: what the piece counts of a material key tell the evaluation
+  */
+typedef struct {
+	U64 materialKey;
+	/**
+	  * Imbalance score from White's side, e.g. the bishop pair
+	  */
+	int imbalance;
+	/**
+	  * Game phase, TOTAL_PHASE in the opening down to 0 in a pawn endgame
+	  */
+	int phase;
+	/**
+	  * Specialised evaluation, ENDGAME_NONE for the normal evaluation, and the side it favours
+	  */
+	int endgame;
+	int strongSide;
+	/**
+	  * Scale factor for White's and Black's scores, see SCALE_NORMAL
+	  */
+	int scale[2];
+} S_MATERIALENTRY;
+
+/**
+  * Structure for material Hash Table. Each search thread has its own, like the pawn Hash Table
+  */
+typedef struct {
+	S_MATERIALENTRY entries[MATERIAL_HASH_SIZE];
+} S_MATERIALTABLE;
+
+/**
+  * Number of entries in an evaluation cache, a power of two
+  */
+#define EVAL_HASH_SIZE 16384
+
+/**
+  * Structure for evaluation cache entry: the evaluation of a position key, for the side to move
   */
 typedef struct {
 	U64 posKey;
-	int move;
-} S_PVENTRY;
+	int score;
+} S_EVALENTRY;
 
 /**
-  * Structure for Principal Variation Table
+  * Structure for evaluation cache. Each search thread has its own, like the pawn Hash Table
   */
 typedef struct {
-	S_PVENTRY *pTable;
-	int numEntries;
-} S_PVTABLE;
+	S_EVALENTRY entries[EVAL_HASH_SIZE];
+} S_EVALTABLE;
+
+/**
+  * Size of the accumulator of each side, and number of network inputs: 64 King squares times 641 piece-square features
+  */
+#define NNUE_HALF_DIMS 256
+#define NNUE_INPUTS (64 * 641)
+
+/**
+  * Structure for the NNUE accumulator of a position: the first layer of the network for each side, and the
+  * pieces the move to the position changed, to update it from the previous position's
+  */
+typedef struct {
+	int16_t values[2][NNUE_HALF_DIMS];
+	/**
+	  * TRUE when the values of a side are up to date
+	  */
+	int computed[2];
+	/**
+	  * Number of changed pieces, -1 if unknown. Each piece leaves its 64 based from square and goes to its to
+	  * square, NO_SQ when it's added or removed
+	  */
+	int dirtyNum;
+	int dirtyPce[3];
+	int dirtyFrom[3];
+	int dirtyTo[3];
+} S_ACCUMULATOR;
 
 /**
   * Structure for Undo Moves
@@ -264,6 +554,32 @@ typedef struct {
     U64 posKey;
 } S_UNDO;
 
+/**
+  * Structure for the magic bitboard of a slider on a square
+  * Magic Bitboards in Chess Programming Wiki: https://www.chessprogramming.org/Magic_Bitboards
+  */
+typedef struct {
+    /**
+      * Squares whose occupancy changes the attacks, without the edges of the board
+      */
+    U64 mask;
+
+    /**
+      * Magic number, hashes the masked occupancy to an index without destructive collisions
+      */
+    U64 magic;
+
+    /**
+      * Attacks of the square indexed by the hashed occupancy
+      */
+    U64 *attacks;
+
+    /**
+      * Shift of the hashed occupancy: 64 minus the number of bits in the mask
+      */
+    int shift;
+} S_MAGIC;
+
 /**
   * Structure for the Board
   */
@@ -279,6 +595,16 @@ typedef struct {
       */
     U64 pawns[NUM_COLORS];
 
+    /**
+      * Bit Board of each piece type, one bit for each square the piece is on
+      */
+    U64 pieceBB[NUM_PIECES];
+
+    /**
+      * Occupancy Bit Boards. Represented by side/color - White, Black or Both
+      */
+    U64 occupancy[NUM_COLORS];
+
     /**
       * Square the King is on
       */
@@ -319,6 +645,16 @@ typedef struct {
       */
     U64 posKey;
 
+    /**
+      * Key of the pawns only, for the pawn Hash Table
+      */
+    U64 pawnKey;
+
+    /**
+      * Key of the piece counts, for the material Hash Table
+      */
+    U64 materialKey;
+
     /**
       * Number of pieces on board
       */
@@ -344,6 +680,13 @@ typedef struct {
       */
     int material[2];
 
+    /**
+      * Middlegame and endgame piece-square scores of all pieces from White's side,
+      * updated with the pieces like the material
+      */
+    int pstMg;
+    int pstEg;
+
     /**
       * Array of history for undo
       */
@@ -358,9 +701,29 @@ typedef struct {
     int pList[NUM_PIECES][MAX_PIECE_NUM];
 
     /**
-      * Principal Variation Table
+      * Hash Table (Transposition Table), shared by all search threads
+      */
+    S_HASHTABLE *HashTable;
+
+    /**
+      * Pawn Hash Table of the thread searching this board, NULL to evaluate without it
       */
-    S_PVTABLE PvTable[1];
+    S_PAWNTABLE *PawnTable;
+
+    /**
+      * Material Hash Table of the thread searching this board, NULL to evaluate without it
+      */
+    S_MATERIALTABLE *MaterialTable;
+
+    /**
+      * Evaluation cache of the thread searching this board, NULL to evaluate without it
+      */
+    S_EVALTABLE *EvalTable;
+
+    /**
+      * NNUE accumulators of the thread searching this board by history ply, NULL if the board isn't evaluated
+      */
+    S_ACCUMULATOR *Accumulators;
 
     /**
       * Principal Variation array
@@ -384,13 +747,13 @@ typedef struct {
   */
 typedef struct {
     /**
-      * Start time of search
+      * Start time of search, from GetTimeMs
       */
-	int starttime;
+	U64 starttime;
 	/**
-      * Stop time of search
+      * Stop time of search, from GetTimeMs
       */
-	int stoptime;
+	U64 stoptime;
 	/**
       * Depth of search
       */
@@ -400,10 +763,20 @@ typedef struct {
       */
 	int depthset;
 	/**
-      * Time set by protocol
+      * Time set by protocol. The stop time is then the maximum time of the move
       */
 	int timeset;
 	/**
+      * Optimum time of the move in ms, scaled after each iteration; 0 to use the time up to the stop time
+      */
+	U64 optimumTime;
+	/**
+      * Best move and score of the last iteration, and the number of iterations the best move hasn't changed
+      */
+	int lastBestMove;
+	int lastScore;
+	int stableIterations;
+	/**
       * Moves to go set by protocol based on time control
       */
 	int movestogo;
@@ -411,20 +784,74 @@ typedef struct {
       * If set to true, the search continues until the protocol asks to stop it
       */
 	int infinite;
+	/**
+      * Set while pondering on the opponent's expected move: the time limits apply from 'ponderhit' on
+      */
+	int ponder;
+
+    /**
+      * Number of lines to search, set by the MultiPV option. Each line is the best move left
+      * once the moves of the lines before it are excluded at the root
+      */
+	int multiPV;
+	/**
+      * Root moves excluded from the line being searched: the moves of the lines already found in this iteration
+      */
+	int excludedNum;
+	int excludedMoves[MAX_MULTIPV];
+	/**
+      * Moves of the lines of the last iteration in order, to start each line with the best move left
+      */
+	int rootMoveNum;
+	int rootMoves[MAX_MULTIPV];
+	/**
+      * Best move of the last root search, kept apart from the Hash Table that the helper threads write to as well
+      */
+	int rootBestMove;
+
+    /**
+      * Count of all the positions this thread visits in the search tree
+      */
+	U64 nodes;
 
     /**
-      * Count of all the positions the engine visits in the search tree
+      * Nodes left until the next check of the time and the input, and the time and node count of the last check.
+      * The interval adapts to the speed of the search and the time left, see CheckUp
       */
-	long nodes;
+	int checkNodes;
+	U64 lastCheckTime;
+	U64 lastCheckNodes;
 
     /**
       * Set when the protocol sets it to quit search
       */
 	int quit;
 	/**
-      * Signal by protocol to stop searching and send result
+      * Signal by protocol to stop searching and send result. Set by the main thread for helper threads,
+      * atomic as other threads read it
+      */
+	_Atomic int stopped;
+
+    /**
+      * Number of search threads set by protocol, and the id of the thread searching with this info (0 for main)
       */
-	int stopped;
+	int threadNum;
+	int threadId;
+
+    /**
+      * If set to true, the search doesn't read the protocol's input, e.g. for the bench
+      */
+	int ignoreInput;
+
+    /**
+      * Set while the main thread searches, so the input thread can answer 'isready' without stopping it
+      */
+	_Atomic int searching;
+
+    /**
+      * Sequence number of the last protocol line taken when the search started, see ReadInput
+      */
+	int inputSeq;
 
     /**
       * Fail high and fail high first. Used for move ordering.
@@ -440,6 +867,52 @@ typedef struct {
 
 } S_SEARCHINFO;
 
+/**
+  * Structure for a line of the MultiPV analysis: its score and Principal Variation
+  */
+typedef struct {
+	int score;
+	int pvMoves;
+	int pv[MAXDEPTH];
+} S_PVLINE;
+
+/**
+  * Structure for a helper search thread. Each helper searches its own copy of the board,
+  * with its own killers, history, pawn and material Hash Tables, evaluation cache and NNUE accumulators, through the
+  * shared Hash Table
+  */
+typedef struct {
+	S_BOARD pos[1];
+	S_SEARCHINFO info[1];
+	S_PAWNTABLE pawnTable[1];
+	S_MATERIALTABLE materialTable[1];
+	S_EVALTABLE evalTable[1];
+	S_ACCUMULATOR accumulators[MAXGAMEMOVES];
+	pthread_t handle;
+} S_SEARCHTHREAD;
+
+/**
+  * Structure for a perft Hash Table entry: the leaf node count of a position at a depth
+  */
+typedef struct {
+	/**
+      * Position key XOR data, verified like the search Hash Table entries
+      */
+	U64 smpKey;
+	/**
+      * Leaf node count << 8 | depth
+      */
+	U64 data;
+} S_PERFTENTRY;
+
+/**
+  * Structure for a perft thread, counting root moves on its own copy of the board
+  */
+typedef struct {
+	S_BOARD pos[1];
+	pthread_t handle;
+} S_PERFTTHREAD;
+
 /* GAME MOVE */
 /*
 
@@ -497,6 +970,11 @@ typedef struct {
 #define FR2SQ64(f,r) SQ64(FR2SQ(f,r))
 #define POP(bb) PopBit(bb)
 #define CNT(bb) CountBits(bb)
+/**
+  * Minimum and maximum of two values
+  */
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
 
 /* Alternate Definitions */
 // Least Significant File (LSF) Mapping for 64 based index
@@ -628,6 +1106,7 @@ extern int PieceBig[NUM_PIECES];
 extern int PieceMaj[NUM_PIECES];
 extern int PieceMin[NUM_PIECES];
 extern int PieceVal[NUM_PIECES];
+extern int PiecePhase[NUM_PIECES];
 extern int PieceCol[NUM_PIECES];
 extern int PiecePawn[NUM_PIECES];
 
@@ -654,6 +1133,17 @@ extern int PieceBishop[NUM_PIECES];*/
   */
 #define SETBIT(bb,sq64) ((bb) |= SetMask[(sq64)])
 
+/**
+  * Get the piece of a side from the White piece, e.g. SIDE_PCE(wN, BLACK) is bN
+  */
+#define SIDE_PCE(pce,side) ((pce) + 6 * (side))
+
+/**
+  * Attacks of a Bishop or a Rook on a 64 based square for the occupancy, by magic bitboards
+  */
+#define BISHOP_ATTACKS(sq64,occ) (BishopMagics[(sq64)].attacks[(((occ) & BishopMagics[(sq64)].mask) * BishopMagics[(sq64)].magic) >> BishopMagics[(sq64)].shift])
+#define ROOK_ATTACKS(sq64,occ) (RookMagics[(sq64)].attacks[(((occ) & RookMagics[(sq64)].mask) * RookMagics[(sq64)].magic) >> RookMagics[(sq64)].shift])
+
 /**
   * Checks if the piece is a Bishop or Queen
   */
@@ -699,6 +1189,8 @@ extern void Test();
 
 // hashkeys.c
 extern U64 GeneratePosKey(const S_BOARD *pos);
+extern U64 GeneratePawnKey(const S_BOARD *pos);
+extern U64 GenerateMaterialKey(const S_BOARD *pos);
 
 // board.c
 extern int CheckBoard(const S_BOARD *pos);
@@ -721,7 +1213,18 @@ extern char FileChar[];
 extern char* SquareNames[];
 
 // attack.c
+extern U64 KnightAttacks[BRD_SQUARES];
+extern U64 KingAttacks[BRD_SQUARES];
+extern U64 PawnAttacks[2][BRD_SQUARES];
+extern S_MAGIC BishopMagics[BRD_SQUARES];
+extern S_MAGIC RookMagics[BRD_SQUARES];
+extern U64 BetweenBB[BRD_SQUARES][BRD_SQUARES];
+extern U64 LineBB[BRD_SQUARES][BRD_SQUARES];
+extern void InitAttacks();
+extern U64 AttackersTo(const S_BOARD *pos, const int sq64, const U64 occ);
+extern U64 AttacksFrom(const int pce, const int sq64, const U64 occ);
 extern int SqAttacked(const int sq, const int side, const S_BOARD *pos);
+extern int StaticExchangeEval(const S_BOARD *pos, const int move);
 
 // io.c
 extern char *PrSq(const int sq);
@@ -741,6 +1244,12 @@ extern void AddBlackPawnMove(const S_BOARD *pos, const int from, const int to, S
 extern void GenerateAllMoves(const S_BOARD *pos, S_MOVELIST *list);
 extern int InitMvvLva();
 extern void GenerateAllCaps(const S_BOARD *pos, S_MOVELIST *list);
+extern void GenerateAllQuiets(const S_BOARD *pos, S_MOVELIST *list);
+extern int MoveIsPseudoLegal(const S_BOARD *pos, const int move);
+extern void InitCheckInfo(const S_BOARD *pos, S_CHECKINFO *checkInfo);
+extern int MoveIsLegal(const S_BOARD *pos, const int move);
+extern void InitMovePicker(S_MOVEPICKER *picker, const S_BOARD *pos, const int hashMove, const int capturesOnly);
+extern int NextMove(S_MOVEPICKER *picker, const S_BOARD *pos);
 
 // validate.c
 extern int SqOnBoard(const int sq);
@@ -750,30 +1259,73 @@ extern int PieceValidEmpty(const int pce);
 extern int PieceValid(const int pce);
 
 // makemove.c
-extern int MoveExists(S_BOARD *pos, const int move);
-extern int MakeMove(S_BOARD *pos, int move);
+extern int MoveExists(const S_BOARD *pos, const int move);
+extern void MakeMove(S_BOARD *pos, int move);
 extern void TakeMove(S_BOARD *pos);
+extern void MakeNullMove(S_BOARD *pos);
+extern void TakeNullMove(S_BOARD *pos);
 
 // perft.c
-extern void PerftTest(int depth, S_BOARD *pos);
+extern U64 Perft(const int depth, S_BOARD *pos);
+extern U64 PerftRoot(const int depth, S_BOARD *pos, int threadNum, const int divide);
+extern void PerftTest(const int depth, S_BOARD *pos, const int threadNum);
+extern int PerftSuite(const char *fileName, const int maxDepth, S_BOARD *pos, const int threadNum);
 
 // search.c
 //extern int IsRepetition(const S_BOARD *pos);
+extern void InitSearch();
 extern void SearchPosition(S_BOARD *pos, S_SEARCHINFO *info);
+extern void SetSearchThreads(S_SEARCHINFO *info, int threadNum);
+extern void ClearEvalTables(S_BOARD *pos);
 
 // misc.c
-extern int GetTimeMs();
+extern U64 GetTimeMs();
+
+// timeman.c
+extern void SetTimeLimits(S_SEARCHINFO *info, const int time, const int inc, const int movestogo, const int movetime);
+extern int StopAfterIteration(S_SEARCHINFO *info, const int bestMove, const int score);
+
+// input.c
+extern int StartInputThread(S_SEARCHINFO *info);
+extern int GetInputLine(char *line, const int size);
+extern int InputLastLine();
 extern void ReadInput(S_SEARCHINFO *info);
+extern void WaitPonderEnd(S_SEARCHINFO *info);
 
 // pvtable.c
-extern void InitPvTable(S_PVTABLE *table);
-extern void StorePvMove(const S_BOARD *pos, const int move);
-extern int ProbePvTable(const S_BOARD *pos);
+extern S_HASHTABLE HashTable[1];
+extern void InitHashTable(S_HASHTABLE *table, const int MB);
+extern int HashFull(const S_HASHTABLE *table);
+extern void ClearHashTable(S_HASHTABLE *table);
+extern void StoreHashEntry(S_BOARD *pos, const int move, int score, const int flags, const int depth);
+extern int ProbeHashEntry(S_BOARD *pos, int *move, int *score, int alpha, int beta, int depth);
+extern int ProbePvMove(const S_BOARD *pos);
+extern int GetPvLine(const int depth, S_BOARD *pos);
 
 // evaluate.c
+extern int PstMg[NUM_PIECES][BRD_SQUARES];
+extern int PstEg[NUM_PIECES][BRD_SQUARES];
+extern void InitEval();
 extern int EvalPosition(const S_BOARD *pos);
 
 // uci.c
 extern void Uci_Loop(S_BOARD *pos, S_SEARCHINFO *info);
 
+// material.c
+extern const S_MATERIALENTRY *ProbeMaterial(const S_BOARD *pos, S_MATERIALENTRY *scratch);
+extern int MaterialDraw(const S_BOARD *pos);
+extern int EvalEndgame(const S_BOARD *pos, const S_MATERIALENTRY *entry, int score);
+
+// nnue.c
+extern int UseNnue;
+extern int LoadNnue(const char *fileName);
+extern void UnloadNnue();
+extern void NnueMakeMove(S_BOARD *pos, const int move);
+extern void NnueMakeNullMove(S_BOARD *pos);
+extern void NnueReset(S_BOARD *pos);
+extern int NnueEvaluate(const S_BOARD *pos);
+
+// bench.c
+extern void Bench(S_BOARD *pos, S_SEARCHINFO *info, const int depth, const int MB);
+
 #endif // DEFS_H
@@ -11,6 +11,9 @@
 #include "defs.h"
 #include "stdio.h"
 
+/**
+  * Middlegame tables of the piece's positional value, from White's side with A1 first
+  */
 const int PawnTable[BRD_SQUARES] = {
 0	,	0	,	0	,	0	,	0	,	0	,	0	,	0	,
 10	,	10	,	0	,	-10	,	-10	,	0	,	10	,	10	,
@@ -55,6 +58,100 @@ const int RookTable[BRD_SQUARES] = {
 0	,	0	,	5	,	10	,	10	,	5	,	0	,	0
 };
 
+/**
+  * Endgame tables: advanced pawns are worth more, the pieces and the King belong in the centre
+  */
+const int PawnTableEg[BRD_SQUARES] = {
+0	,	0	,	0	,	0	,	0	,	0	,	0	,	0	,
+0	,	0	,	0	,	0	,	0	,	0	,	0	,	0	,
+5	,	5	,	5	,	5	,	5	,	5	,	5	,	5	,
+10	,	10	,	10	,	10	,	10	,	10	,	10	,	10	,
+20	,	20	,	20	,	20	,	20	,	20	,	20	,	20	,
+35	,	35	,	35	,	35	,	35	,	35	,	35	,	35	,
+60	,	60	,	60	,	60	,	60	,	60	,	60	,	60	,
+0	,	0	,	0	,	0	,	0	,	0	,	0	,	0
+};
+
+const int KnightTableEg[BRD_SQUARES] = {
+-20	,	-10	,	-10	,	-10	,	-10	,	-10	,	-10	,	-20	,
+-10	,	0	,	0	,	5	,	5	,	0	,	0	,	-10	,
+-10	,	0	,	10	,	15	,	15	,	10	,	0	,	-10	,
+-10	,	5	,	15	,	20	,	20	,	15	,	5	,	-10	,
+-10	,	5	,	15	,	20	,	20	,	15	,	5	,	-10	,
+-10	,	0	,	10	,	15	,	15	,	10	,	0	,	-10	,
+-10	,	0	,	0	,	5	,	5	,	0	,	0	,	-10	,
+-20	,	-10	,	-10	,	-10	,	-10	,	-10	,	-10	,	-20
+};
+
+const int BishopTableEg[BRD_SQUARES] = {
+-10	,	-5	,	-5	,	-5	,	-5	,	-5	,	-5	,	-10	,
+-5	,	0	,	0	,	5	,	5	,	0	,	0	,	-5	,
+-5	,	0	,	10	,	10	,	10	,	10	,	0	,	-5	,
+-5	,	5	,	10	,	15	,	15	,	10	,	5	,	-5	,
+-5	,	5	,	10	,	15	,	15	,	10	,	5	,	-5	,
+-5	,	0	,	10	,	10	,	10	,	10	,	0	,	-5	,
+-5	,	0	,	0	,	5	,	5	,	0	,	0	,	-5	,
+-10	,	-5	,	-5	,	-5	,	-5	,	-5	,	-5	,	-10
+};
+
+const int RookTableEg[BRD_SQUARES] = {
+0	,	0	,	0	,	0	,	0	,	0	,	0	,	0	,
+0	,	0	,	0	,	0	,	0	,	0	,	0	,	0	,
+0	,	0	,	0	,	0	,	0	,	0	,	0	,	0	,
+0	,	0	,	0	,	0	,	0	,	0	,	0	,	0	,
+0	,	0	,	0	,	0	,	0	,	0	,	0	,	0	,
+0	,	0	,	0	,	0	,	0	,	0	,	0	,	0	,
+15	,	15	,	15	,	15	,	15	,	15	,	15	,	15	,
+0	,	0	,	0	,	0	,	0	,	0	,	0	,	0
+};
+
+/**
+  * Queen and King tables for the middlegame, the King stays sheltered on its back rank
+  */
+const int QueenTable[BRD_SQUARES] = {
+-10	,	-5	,	-5	,	0	,	0	,	-5	,	-5	,	-10	,
+-5	,	0	,	5	,	5	,	5	,	5	,	0	,	-5	,
+-5	,	5	,	5	,	5	,	5	,	5	,	5	,	-5	,
+0	,	0	,	5	,	5	,	5	,	5	,	0	,	0	,
+0	,	0	,	5	,	5	,	5	,	5	,	0	,	0	,
+-5	,	0	,	5	,	5	,	5	,	5	,	0	,	-5	,
+-5	,	0	,	0	,	0	,	0	,	0	,	0	,	-5	,
+-10	,	-5	,	-5	,	-5	,	-5	,	-5	,	-5	,	-10
+};
+
+const int KingTable[BRD_SQUARES] = {
+0	,	5	,	5	,	-10	,	-10	,	0	,	10	,	5	,
+-30	,	-30	,	-30	,	-30	,	-30	,	-30	,	-30	,	-30	,
+-50	,	-50	,	-50	,	-50	,	-50	,	-50	,	-50	,	-50	,
+-70	,	-70	,	-70	,	-70	,	-70	,	-70	,	-70	,	-70	,
+-70	,	-70	,	-70	,	-70	,	-70	,	-70	,	-70	,	-70	,
+-70	,	-70	,	-70	,	-70	,	-70	,	-70	,	-70	,	-70	,
+-70	,	-70	,	-70	,	-70	,	-70	,	-70	,	-70	,	-70	,
+-70	,	-70	,	-70	,	-70	,	-70	,	-70	,	-70	,	-70
+};
+
+const int QueenTableEg[BRD_SQUARES] = {
+-20	,	-10	,	-10	,	-10	,	-10	,	-10	,	-10	,	-20	,
+-10	,	0	,	5	,	5	,	5	,	5	,	0	,	-10	,
+-10	,	5	,	10	,	10	,	10	,	10	,	5	,	-10	,
+-10	,	5	,	10	,	20	,	20	,	10	,	5	,	-10	,
+-10	,	5	,	10	,	20	,	20	,	10	,	5	,	-10	,
+-10	,	5	,	10	,	10	,	10	,	10	,	5	,	-10	,
+-10	,	0	,	5	,	5	,	5	,	5	,	0	,	-10	,
+-20	,	-10	,	-10	,	-10	,	-10	,	-10	,	-10	,	-20
+};
+
+const int KingTableEg[BRD_SQUARES] = {
+-50	,	-10	,	0	,	0	,	0	,	0	,	-10	,	-50	,
+-10	,	0	,	10	,	10	,	10	,	10	,	0	,	-10	,
+0	,	10	,	20	,	20	,	20	,	20	,	10	,	0	,
+0	,	10	,	20	,	40	,	40	,	20	,	10	,	0	,
+0	,	10	,	20	,	40	,	40	,	20	,	10	,	0	,
+0	,	10	,	20	,	20	,	20	,	20	,	10	,	0	,
+-10	,	0	,	10	,	10	,	10	,	10	,	0	,	-10	,
+-50	,	-10	,	0	,	0	,	0	,	0	,	-10	,	-50
+};
+
 const int Mirror64[BRD_SQUARES] = {
 56	,	57	,	58	,	59	,	60	,	61	,	62	,	63	,
 48	,	49	,	50	,	51	,	52	,	53	,	54	,	55	,
@@ -72,91 +169,247 @@ const int Mirror64[BRD_SQUARES] = {
 #define MIRROR64(sq) (Mirror64[(sq)])
 
 /**
-  * @brief Function to evaluate a position
-  *
-  * @param *pos Pointer to the board structure
-  * @return Score of the evaluation
+  * Pawn structure scores for the middlegame and the endgame. Passed pawns by their rank from their own side
   */
-int EvalPosition(const S_BOARD *pos) {
+const int PassedPawnMg[8] = { 0, 5, 10, 15, 25, 40, 60, 0 };
+const int PassedPawnEg[8] = { 0, 10, 15, 25, 40, 65, 100, 0 };
+const int IsolatedPawnMg = -10;
+const int IsolatedPawnEg = -15;
+const int DoubledPawnMg = -10;
+const int DoubledPawnEg = -20;
+const int BackwardPawnMg = -8;
+const int BackwardPawnEg = -10;
+
+/**
+  * Pawn structure masks by 64 based square: the squares of a file, of the adjacent files,
+  * the squares in front of a pawn on its own and the adjacent files (passed pawn) and the squares
+  * on the adjacent files level with or behind a pawn (its supporters, backward pawn)
+  */
+static U64 FileMask[8];
+static U64 AdjacentFilesMask[8];
+static U64 PassedMask[2][BRD_SQUARES];
+static U64 SupportMask[2][BRD_SQUARES];
+
+/**
+  * Piece-square scores of each piece from White's side, for the middlegame and the endgame.
+  * Black's pieces take the mirrored square of White's tables, negated.
+  */
+int PstMg[NUM_PIECES][BRD_SQUARES];
+int PstEg[NUM_PIECES][BRD_SQUARES];
+
+/**
+  * @brief Function to initialize the piece-square tables of all pieces
+  */
+void InitEval() {
+
+	int sq64 = 0;
+	int sq = 0;
+	int pce = EMPTY;
+	const int *tableMg = NULL;
+	const int *tableEg = NULL;
+
+	// Files and adjacent files
+	for(sq64 = 0; sq64 < 8; ++sq64) {
+		FileMask[sq64] = 0x0101010101010101ULL << sq64;
+	}
+
+	for(sq64 = 0; sq64 < 8; ++sq64) {
+		AdjacentFilesMask[sq64] = (sq64 > 0 ? FileMask[sq64 - 1] : 0ULL) | (sq64 < 7 ? FileMask[sq64 + 1] : 0ULL);
+	}
+
+	// Squares ahead of and level with or behind each pawn, for both sides
+	for(sq64 = 0; sq64 < BRD_SQUARES; ++sq64) {
+		PassedMask[WHITE][sq64] = 0ULL;
+		PassedMask[BLACK][sq64] = 0ULL;
+		SupportMask[WHITE][sq64] = 0ULL;
+		SupportMask[BLACK][sq64] = 0ULL;
+
+		for(sq = 0; sq < BRD_SQUARES; ++sq) {
+			if(!((FileMask[sq64 & 7] | AdjacentFilesMask[sq64 & 7]) & SetMask[sq])) {
+				continue;
+			}
+
+			if(sq / 8 > sq64 / 8) {
+				PassedMask[WHITE][sq64] |= SetMask[sq];
+			} else if(sq / 8 < sq64 / 8) {
+				PassedMask[BLACK][sq64] |= SetMask[sq];
+			}
 
-	int pce;
-	int pceNum;
-	int sq;
-	// Initialize the score to total material value of White minus the total material value of Black
-	int score = pos->material[WHITE] - pos->material[BLACK];
-
-    // Evaluate White Pawns
-	pce = wP;
-	// Loop through all White Pawns and add their positional value to the score
-	for(pceNum = 0; pceNum < pos->pceNum[pce]; ++pceNum) {
-		sq = pos->pList[pce][pceNum];
-		ASSERT(SqOnBoard(sq));
-		score += PawnTable[SQ64(sq)];
+			if((AdjacentFilesMask[sq64 & 7] & SetMask[sq]) && sq / 8 <= sq64 / 8) {
+				SupportMask[WHITE][sq64] |= SetMask[sq];
+			}
+
+			if((AdjacentFilesMask[sq64 & 7] & SetMask[sq]) && sq / 8 >= sq64 / 8) {
+				SupportMask[BLACK][sq64] |= SetMask[sq];
+			}
+		}
 	}
 
-    // Evaluate Black Pawns
-	pce = bP;
-	// Loop through all Black Pawns and subtract their positional value to the score
-	for(pceNum = 0; pceNum < pos->pceNum[pce]; ++pceNum) {
-		sq = pos->pList[pce][pceNum];
-		ASSERT(SqOnBoard(sq));
-		score -= PawnTable[MIRROR64(SQ64(sq))];
+	for(pce = EMPTY; pce < NUM_PIECES; ++pce) {
+		// Get the tables of the piece type
+		switch(pce) {
+			case wP: case bP: tableMg = PawnTable; tableEg = PawnTableEg; break;
+			case wN: case bN: tableMg = KnightTable; tableEg = KnightTableEg; break;
+			case wB: case bB: tableMg = BishopTable; tableEg = BishopTableEg; break;
+			case wR: case bR: tableMg = RookTable; tableEg = RookTableEg; break;
+			case wQ: case bQ: tableMg = QueenTable; tableEg = QueenTableEg; break;
+			case wK: case bK: tableMg = KingTable; tableEg = KingTableEg; break;
+			default: tableMg = NULL; tableEg = NULL; break;
+		}
+
+		for(sq64 = 0; sq64 < BRD_SQUARES; ++sq64) {
+			if(tableMg == NULL) {
+				PstMg[pce][sq64] = 0;
+				PstEg[pce][sq64] = 0;
+			} else if(PieceCol[pce] == WHITE) {
+				PstMg[pce][sq64] = tableMg[sq64];
+				PstEg[pce][sq64] = tableEg[sq64];
+			} else {
+				PstMg[pce][sq64] = -tableMg[MIRROR64(sq64)];
+				PstEg[pce][sq64] = -tableEg[MIRROR64(sq64)];
+			}
+		}
 	}
+}
+
+/**
+  * @brief Function to evaluate the pawn structure of a side: passed, isolated, doubled and backward pawns
+  *
+  * @param *pos Pointer to the board structure
+  * @param side Side of the pawns
+  * @param *mg Middlegame score of the side's pawns, added to
+  * @param *eg Endgame score of the side's pawns, added to
+  */
+static void EvalPawnsSide(const S_BOARD *pos, const int side, int *mg, int *eg) {
+
+	U64 own = pos->pawns[side];
+	U64 enemy = pos->pawns[side ^ 1];
+	U64 pawns = own;
+	int sq64 = 0;
+	int file = 0;
+	int rank = 0;
+	int count = 0;
+	int stop = 0;
 
-    // Evaluate White Knights
-	pce = wN;
-	// Loop through all White Knights and add their positional value to the score
-	for(pceNum = 0; pceNum < pos->pceNum[pce]; ++pceNum) {
-		sq = pos->pList[pce][pceNum];
-		ASSERT(SqOnBoard(sq));
-		score += KnightTable[SQ64(sq)];
+	// Every pawn beyond the first on a file is doubled
+	for(file = 0; file < 8; ++file) {
+		count = CNT(own & FileMask[file]);
+
+		if(count > 1) {
+			*mg += DoubledPawnMg * (count - 1);
+			*eg += DoubledPawnEg * (count - 1);
+		}
 	}
 
-    // Evaluate Black Knights
-	pce = bN;
-	// Loop through all Black Knights and subtract their positional value to the score
-	for(pceNum = 0; pceNum < pos->pceNum[pce]; ++pceNum) {
-		sq = pos->pList[pce][pceNum];
-		ASSERT(SqOnBoard(sq));
-		score -= KnightTable[MIRROR64(SQ64(sq))];
+	while(pawns) {
+		sq64 = POP(&pawns);
+		file = sq64 & 7;
+		// Rank from the side's own side
+		rank = (side == WHITE) ? sq64 / 8 : 7 - sq64 / 8;
+
+		// Passed: no enemy pawn in front on its own or the adjacent files, and no own pawn in front of it
+		if(!(PassedMask[side][sq64] & enemy) && !(PassedMask[side][sq64] & FileMask[file] & own)) {
+			*mg += PassedPawnMg[rank];
+			*eg += PassedPawnEg[rank];
+			continue;
+		}
+
+		// Isolated: no own pawn on the adjacent files
+		if(!(AdjacentFilesMask[file] & own)) {
+			*mg += IsolatedPawnMg;
+			*eg += IsolatedPawnEg;
+			continue;
+		}
+
+		// Backward: no own pawn level with or behind it on the adjacent files, and its stop square is attacked
+		stop = (side == WHITE) ? sq64 + 8 : sq64 - 8;
+
+		if(!(SupportMask[side][sq64] & own) && (PawnAttacks[side][stop] & enemy)) {
+			*mg += BackwardPawnMg;
+			*eg += BackwardPawnEg;
+		}
 	}
+}
+
+/**
+  * @brief Function to evaluate the pawn structure, cached in the board's pawn Hash Table by the pawn key
+  *
+  * @param *pos Pointer to the board structure
+  * @param *mg Set to the middlegame score of the pawn structure, from White's side
+  * @param *eg Set to the endgame score of the pawn structure, from White's side
+  */
+static void EvalPawns(const S_BOARD *pos, int *mg, int *eg) {
+
+	S_PAWNENTRY *entry = NULL;
+	int whiteMg = 0;
+	int whiteEg = 0;
+	int blackMg = 0;
+	int blackEg = 0;
 
-    // Evaluate White Bishops
-	pce = wB;
-	// Loop through all White Bishops and add their positional value to the score
-	for(pceNum = 0; pceNum < pos->pceNum[pce]; ++pceNum) {
-		sq = pos->pList[pce][pceNum];
-		ASSERT(SqOnBoard(sq));
-		score += BishopTable[SQ64(sq)];
+	if(pos->PawnTable != NULL) {
+		entry = &pos->PawnTable->entries[pos->pawnKey & (PAWN_HASH_SIZE - 1)];
+
+		if(entry->pawnKey == pos->pawnKey) {
+			*mg = entry->mg;
+			*eg = entry->eg;
+			return;
+		}
 	}
 
-    // Evaluate Black Bishops
-	pce = bB;
-	// Loop through all Black Bishops and subtract their positional value to the score
-	for(pceNum = 0; pceNum < pos->pceNum[pce]; ++pceNum) {
-		sq = pos->pList[pce][pceNum];
-		ASSERT(SqOnBoard(sq));
-		score -= BishopTable[MIRROR64(SQ64(sq))];
+	EvalPawnsSide(pos, WHITE, &whiteMg, &whiteEg);
+	EvalPawnsSide(pos, BLACK, &blackMg, &blackEg);
+
+	*mg = whiteMg - blackMg;
+	*eg = whiteEg - blackEg;
+
+	// Store the scores, always replacing
+	if(entry != NULL) {
+		entry->pawnKey = pos->pawnKey;
+		entry->mg = *mg;
+		entry->eg = *eg;
 	}
+}
 
-    // Evaluate White Rooks
-	pce = wR;
-	// Loop through all White Rooks and add their positional value to the score
-	for(pceNum = 0; pceNum < pos->pceNum[pce]; ++pceNum) {
-		sq = pos->pList[pce][pceNum];
-		ASSERT(SqOnBoard(sq));
-		score += RookTable[SQ64(sq)];
+/**
+  * @brief Function to compute the evaluation of a position
+  *
+  * @param *pos Pointer to the board structure
+  * @return Score of the evaluation
+  */
+static int Evaluate(const S_BOARD *pos) {
+
+	S_MATERIALENTRY scratch[1];
+	// Imbalance, game phase and endgame knowledge of the piece counts, mostly from the material Hash Table
+	const S_MATERIALENTRY *entry = ProbeMaterial(pos, scratch);
+
+	if(entry->endgame == ENDGAME_DRAW) {
+		return 0;
 	}
 
-    // Evaluate Black Rooks
-	pce = bR;
-	// Loop through all Black Rooks and subtract their positional value to the score
-	for(pceNum = 0; pceNum < pos->pceNum[pce]; ++pceNum) {
-		sq = pos->pList[pce][pceNum];
-		ASSERT(SqOnBoard(sq));
-		score -= RookTable[MIRROR64(SQ64(sq))];
+	// With a network loaded, it replaces the hand-written evaluation; the endgame knowledge still applies
+	if(UseNnue && pos->Accumulators != NULL) {
+		int nnue = (pos->side == WHITE) ? NnueEvaluate(pos) : -NnueEvaluate(pos);
+		nnue = EvalEndgame(pos, entry, nnue);
+
+		return (pos->side == WHITE) ? nnue : -nnue;
 	}
 
+	// Total material value of White minus the total material value of Black, and the imbalance
+	int material = pos->material[WHITE] - pos->material[BLACK] + entry->imbalance;
+	// Game phase, TOTAL_PHASE for the middlegame down to 0 for the endgame
+	int phase = entry->phase;
+	int pawnMg = 0;
+	int pawnEg = 0;
+
+	// Pawn structure, mostly from the pawn Hash Table
+	EvalPawns(pos, &pawnMg, &pawnEg);
+
+	// Interpolate between the middlegame and the endgame positional values, kept up to date by the board
+	int score = material + ((pos->pstMg + pawnMg) * phase + (pos->pstEg + pawnEg) * (TOTAL_PHASE - phase)) / TOTAL_PHASE;
+
+	// Scale drawish endgames, or evaluate the ending with its own function
+	score = EvalEndgame(pos, entry, score);
+
     // If it's white to move, return the score; otherwise return the negative of the score as Black
 	if(pos->side == WHITE) {
 		return score;
@@ -165,4 +418,35 @@ int EvalPosition(const S_BOARD *pos) {
 	}
 }
 
+/**
+  * @brief Function to evaluate a position, cached in the board's evaluation cache by the position key
+  * The same positions recur across iterations and sibling subtrees, e.g. at the top of the quiescence search
+  *
+  * @param *pos Pointer to the board structure
+  * @return Score of the evaluation
+  */
+int EvalPosition(const S_BOARD *pos) {
+
+	S_EVALENTRY *entry = NULL;
+	int score = 0;
+
+	if(pos->EvalTable != NULL) {
+		entry = &pos->EvalTable->entries[pos->posKey & (EVAL_HASH_SIZE - 1)];
+
+		if(entry->posKey == pos->posKey) {
+			return entry->score;
+		}
+	}
+
+	score = Evaluate(pos);
+
+	// Store the score, always replacing
+	if(entry != NULL) {
+		entry->posKey = pos->posKey;
+		entry->score = score;
+	}
+
+	return score;
+}
+
 #endif // EVALUATE_C
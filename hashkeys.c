@@ -54,4 +54,47 @@ U64 GeneratePosKey(const S_BOARD *pos) {
     return finalKey;
 }
 
+/**
+  * @brief Function to generate the pawn key of a position: the piece keys of the pawns only
+  *
+  * @param *pos Pointer to the board structure
+  * @return The pawn key
+  */
+U64 GeneratePawnKey(const S_BOARD *pos) {
+    int sq = 0;
+    U64 finalKey = 0;
+    int piece = EMPTY;
+
+    for(sq = 0 ; sq < BRD_SQ_NUM; ++sq) {
+        piece = pos->pieces[sq];
+
+        if(piece == wP || piece == bP) {
+            finalKey ^= PiecesKeys[piece][sq];
+        }
+    }
+
+    return finalKey;
+}
+
+/**
+  * @brief Function to generate the material key of a position from the piece counts.
+  * The n-th piece of a type hashes in the piece key of square n, an off board square
+  *
+  * @param *pos Pointer to the board structure
+  * @return The material key
+  */
+U64 GenerateMaterialKey(const S_BOARD *pos) {
+    int piece = EMPTY;
+    int num = 0;
+    U64 finalKey = 0;
+
+    for(piece = wP; piece <= bK; ++piece) {
+        for(num = 0; num < pos->pceNum[piece]; ++num) {
+            finalKey ^= PiecesKeys[piece][num];
+        }
+    }
+
+    return finalKey;
+}
+
 #endif // HASHKEYS_C
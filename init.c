@@ -142,7 +142,11 @@ void AllInit() {
     InitBitMasks();
     InitHashKeys();
     InitFilesRanksBrd();
+    InitAttacks();
+    InitEval();
     InitMvvLva();
+    InitSearch();
+    InitHashTable(HashTable, HASH_DEFAULT_MB);
 }
 
 #endif // INIT_C
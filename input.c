@@ -0,0 +1,229 @@
+/***********************************************************
+  * File Name: input.c
+  * Author: Somnath Mukherjee
+  * Description:
+  * Input thread reading the protocol's commands into a queue
+  **********************************************************/
+
+#ifndef INPUT_C
+#define INPUT_C
+
+#include "defs.h"
+#include "stdio.h"
+#include "string.h"
+
+/**
+  * Queue of the lines read and not yet taken by the protocol loops, with the sequence number of the last line
+  * put into it and taken out of it. Guarded by InputLock.
+  */
+static char InputQueue[INPUT_QUEUE_SIZE][INPUT_LINE_SIZE];
+static int InputPushed = 0;
+static int InputTaken = 0;
+static int InputClosed = FALSE;
+static pthread_mutex_t InputLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t InputNotEmpty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t InputNotFull = PTHREAD_COND_INITIALIZER;
+
+/**
+  * Sequence number of the last line asking to stop the search. The search stops if it's newer
+  * than the last line taken when the search started. Atomic, the search reads it without the lock.
+  */
+static _Atomic int StopSeq = 0;
+
+/**
+  * Sequence number of the last 'ponderhit': the opponent played the move pondered on, the search goes on
+  * as a timed search
+  */
+static _Atomic int PonderHitSeq = 0;
+
+/**
+  * Search info of the main thread, for the protocol mode and whether it's searching
+  */
+static S_SEARCHINFO *InputInfo = NULL;
+
+/**
+  * @brief Function to check if a line asks to stop the search
+  * With UCI only 'stop' and 'quit' do; with XBoard and the console any command stops the search, as it used to
+  *
+  * @param *line The line
+  * @return TRUE if the line stops the search, FALSE otherwise
+  */
+static int IsStopLine(const char *line) {
+
+	if(InputInfo->GAME_MODE != UCIMODE) {
+		return TRUE;
+	}
+
+	return (!strncmp(line, "stop", 4) || !strncmp(line, "quit", 4)) ? TRUE : FALSE;
+}
+
+/**
+  * @brief Function to put a line into the queue, waiting while the queue is full
+  *
+  * @param *line The line
+  * @param canStop TRUE if the line may stop the search, see IsStopLine
+  */
+static void PushLine(const char *line, const int canStop) {
+
+	pthread_mutex_lock(&InputLock);
+
+	while(InputPushed - InputTaken >= INPUT_QUEUE_SIZE) {
+		pthread_cond_wait(&InputNotFull, &InputLock);
+	}
+
+	strncpy(InputQueue[InputPushed % INPUT_QUEUE_SIZE], line, INPUT_LINE_SIZE - 1);
+	InputQueue[InputPushed % INPUT_QUEUE_SIZE][INPUT_LINE_SIZE - 1] = '\0';
+	InputPushed++;
+
+	if(canStop && IsStopLine(line)) {
+		StopSeq = InputPushed;
+	}
+
+	if(!strncmp(line, "ponderhit", 9)) {
+		PonderHitSeq = InputPushed;
+	}
+
+	pthread_cond_signal(&InputNotEmpty);
+	pthread_mutex_unlock(&InputLock);
+}
+
+/**
+  * @brief Function for the input thread: reads the lines of the protocol into the queue
+  * 'isready' during a search is answered at once, the search doesn't have to stop for it.
+  * At the end of the input, a 'quit' is queued once the search in progress is done.
+  *
+  * @param *arg Unused
+  */
+static void *InputThread(void *arg) {
+
+	char line[INPUT_LINE_SIZE];
+
+	(void) arg;
+
+	while(fgets(line, sizeof(line), stdin) != NULL) {
+		if(InputInfo->searching && InputInfo->GAME_MODE == UCIMODE && !strncmp(line, "isready", 7)) {
+			// Only between the lines the search prints, which hold stdout while they're written
+			flockfile(stdout);
+			printf("readyok\n");
+			funlockfile(stdout);
+			continue;
+		}
+
+		PushLine(line, TRUE);
+	}
+
+	// The search in progress, if any, still completes
+	PushLine("quit\n", FALSE);
+
+	pthread_mutex_lock(&InputLock);
+	InputClosed = TRUE;
+	pthread_cond_broadcast(&InputNotEmpty);
+	pthread_mutex_unlock(&InputLock);
+
+	return NULL;
+}
+
+/**
+  * @brief Function to start the input thread. From then on the protocol's lines are read with GetInputLine
+  *
+  * @param *info Search info of the main thread
+  * @return TRUE if the thread is started, FALSE otherwise
+  */
+int StartInputThread(S_SEARCHINFO *info) {
+
+	pthread_t handle;
+
+	InputInfo = info;
+
+	if(pthread_create(&handle, NULL, InputThread, NULL) != 0) {
+		printf("Input thread creation failed\n");
+		return FALSE;
+	}
+
+	pthread_detach(handle);
+
+	return TRUE;
+}
+
+/**
+  * @brief Function to take the next line of the protocol, waiting for it
+  *
+  * @param *line Buffer for the line, with its new line
+  * @param size Size of the buffer
+  * @return TRUE if a line is read, FALSE at the end of the input
+  */
+int GetInputLine(char *line, const int size) {
+
+	pthread_mutex_lock(&InputLock);
+
+	while(InputTaken == InputPushed && !InputClosed) {
+		pthread_cond_wait(&InputNotEmpty, &InputLock);
+	}
+
+	if(InputTaken == InputPushed) {
+		pthread_mutex_unlock(&InputLock);
+		return FALSE;
+	}
+
+	strncpy(line, InputQueue[InputTaken % INPUT_QUEUE_SIZE], size - 1);
+	line[size - 1] = '\0';
+	InputTaken++;
+
+	pthread_cond_signal(&InputNotFull);
+	pthread_mutex_unlock(&InputLock);
+
+	return TRUE;
+}
+
+/**
+  * @brief Function to get the sequence number of the last line taken, stored by the search when it starts
+  *
+  * @return The sequence number
+  */
+int InputLastLine() {
+
+	int seq = 0;
+
+	pthread_mutex_lock(&InputLock);
+	seq = InputTaken;
+	pthread_mutex_unlock(&InputLock);
+
+	return seq;
+}
+
+/**
+  * @brief Function to check if the protocol asked to stop the search or a ponder search became a timed one,
+  * without any system call. The line itself stays in the queue for the protocol loop.
+  *
+  * @param *info Pointer to search info
+  */
+void ReadInput(S_SEARCHINFO *info) {
+	if(StopSeq > info->inputSeq) {
+		info->stopped = TRUE;
+	}
+
+	if(info->ponder && PonderHitSeq > info->inputSeq) {
+		info->ponder = FALSE;
+	}
+}
+
+/**
+  * @brief Function to wait for the end of a ponder search that finished its iterations:
+  * the best move may only be sent after 'ponderhit' or 'stop'
+  *
+  * @param *info Pointer to search info
+  */
+void WaitPonderEnd(S_SEARCHINFO *info) {
+
+	pthread_mutex_lock(&InputLock);
+
+	while(StopSeq <= info->inputSeq && PonderHitSeq <= info->inputSeq && !InputClosed) {
+		pthread_cond_wait(&InputNotEmpty, &InputLock);
+	}
+
+	pthread_mutex_unlock(&InputLock);
+
+	info->ponder = FALSE;
+}
+
+#endif // INPUT_C
@@ -13,6 +13,8 @@
 #define HASH_CA (pos->posKey ^= (CastleKeys[(pos->castlePerm)]))
 #define HASH_SIDE (pos->posKey ^= (SideKey))
 #define HASH_EP (pos->posKey ^= (PiecesKeys[EMPTY][(pos->enPas)]))
+#define HASH_PAWN(pce,sq) (pos->pawnKey ^= (PiecesKeys[(pce)][(sq)]))
+#define HASH_MAT(pce,num) (pos->materialKey ^= (PiecesKeys[(pce)][(num)]))
 
 #include "defs.h"
 #include "stdio.h"
@@ -61,8 +63,14 @@ static void ClearPiece(const int sq, S_BOARD *pos) {
 
     // Set the square to empty
 	pos->pieces[sq] = EMPTY;
-	// Reduce material value by the piece's value
+	// Clear the piece's and the occupancy Bit Boards
+	CLRBIT(pos->pieceBB[pce], SQ64(sq));
+	CLRBIT(pos->occupancy[col], SQ64(sq));
+	CLRBIT(pos->occupancy[BOTH], SQ64(sq));
+	// Reduce material value by the piece's value and remove its piece-square scores
     pos->material[col] -= PieceVal[pce];
+    pos->pstMg -= PstMg[pce][SQ64(sq)];
+    pos->pstEg -= PstEg[pce][SQ64(sq)];
 
     // Big Piece or Pawn
 	if(PieceBig[pce]) {
@@ -76,9 +84,10 @@ static void ClearPiece(const int sq, S_BOARD *pos) {
 			pos->minPce[col]--;
 		}
 	} else {
-	    // Otherwise, clear the pawns for both the current color and both
+	    // Otherwise, clear the pawns for both the current color and both, and hash out the pawn
 		CLRBIT(pos->pawns[col], SQ64(sq));
 		CLRBIT(pos->pawns[BOTH], SQ64(sq));
+		HASH_PAWN(pce,sq);
 	}
 
 	/*
@@ -104,8 +113,9 @@ static void ClearPiece(const int sq, S_BOARD *pos) {
 
 	ASSERT(t_pceNum != -1);
 
-    // Reduce the piece number for the piece
+    // Reduce the piece number for the piece, hashing out the piece count
 	pos->pceNum[pce]--;
+	HASH_MAT(pce,pos->pceNum[pce]);
 	// pos->pceNum[wP] == 4
 
     // Replace the piece
@@ -142,6 +152,10 @@ static void AddPiece(const int sq, S_BOARD *pos, const int pce) {
 
     // Set the piece on the square
 	pos->pieces[sq] = pce;
+	// Set the piece's and the occupancy Bit Boards
+	SETBIT(pos->pieceBB[pce], SQ64(sq));
+	SETBIT(pos->occupancy[col], SQ64(sq));
+	SETBIT(pos->occupancy[BOTH], SQ64(sq));
 
     // Big Piece or Pawn
     if(PieceBig[pce]) {
@@ -155,14 +169,18 @@ static void AddPiece(const int sq, S_BOARD *pos, const int pce) {
 			pos->minPce[col]++;
 		}
 	} else {
-	    // Otherwise, set the pawns for both the current color and both
+	    // Otherwise, set the pawns for both the current color and both, and hash in the pawn
 		SETBIT(pos->pawns[col], SQ64(sq));
 		SETBIT(pos->pawns[BOTH], SQ64(sq));
+		HASH_PAWN(pce,sq);
 	}
 
-    // Increase material value by the piece's value
+    // Increase material value by the piece's value and add its piece-square scores
 	pos->material[col] += PieceVal[pce];
-	// Add the piece to the piece list
+	pos->pstMg += PstMg[pce][SQ64(sq)];
+	pos->pstEg += PstEg[pce][SQ64(sq)];
+	// Add the piece to the piece list, hashing in the piece count
+	HASH_MAT(pce,pos->pceNum[pce]);
 	pos->pList[pce][pos->pceNum[pce]++] = sq;
 }
 
@@ -198,6 +216,18 @@ static void MovePiece(const int from, const int to, S_BOARD *pos) {
 	// Set the piece on the 'to' square
 	pos->pieces[to] = pce;
 
+    // Move the piece in its and the occupancy Bit Boards
+	CLRBIT(pos->pieceBB[pce], SQ64(from));
+	SETBIT(pos->pieceBB[pce], SQ64(to));
+	CLRBIT(pos->occupancy[col], SQ64(from));
+	SETBIT(pos->occupancy[col], SQ64(to));
+	CLRBIT(pos->occupancy[BOTH], SQ64(from));
+	SETBIT(pos->occupancy[BOTH], SQ64(to));
+
+    // Move the piece-square scores
+	pos->pstMg += PstMg[pce][SQ64(to)] - PstMg[pce][SQ64(from)];
+	pos->pstEg += PstEg[pce][SQ64(to)] - PstEg[pce][SQ64(from)];
+
     // Big Piece or Pawn
 	if(!PieceBig[pce]) {
         // Clear the pawns for both the current color and both
@@ -206,6 +236,9 @@ static void MovePiece(const int from, const int to, S_BOARD *pos) {
         // Set the pawns for both the current color and both
 		SETBIT(pos->pawns[col],SQ64(to));
 		SETBIT(pos->pawns[BOTH],SQ64(to));
+        // Move the pawn in the pawn key
+		HASH_PAWN(pce,from);
+		HASH_PAWN(pce,to);
 	}
 
     // Loop through the piece index for the piece
@@ -230,11 +263,11 @@ static void MovePiece(const int from, const int to, S_BOARD *pos) {
   *
   * @param *pos Pointer to the board structure
   * @param move Move to make
-  * @return TRUE is the move is successfully made, FALSE otherwise
   *
-  * Returns false or zero if after making the move the side which has made the move has made themselves on a check
+  * The move must be legal: the move generator only generates legal moves, and moves from
+  * the Hash Table or the killer slots are checked with MoveIsLegal before they are made
   */
-int MakeMove(S_BOARD *pos, int move) {
+void MakeMove(S_BOARD *pos, int move) {
 
 	ASSERT(CheckBoard(pos));
 
@@ -248,6 +281,11 @@ int MakeMove(S_BOARD *pos, int move) {
     ASSERT(SideValid(side));
     ASSERT(PieceValid(pos->pieces[from]));
 
+    // Record the pieces the move changes for the NNUE accumulator
+    if(pos->Accumulators != NULL) {
+        NnueMakeMove(pos, move);
+    }
+
     // Store the current position to history before making the move
 	pos->history[pos->hisPly].posKey = pos->posKey;
 
@@ -362,16 +400,8 @@ int MakeMove(S_BOARD *pos, int move) {
     HASH_SIDE;
 
     ASSERT(CheckBoard(pos));
-
-    // If after the move the king is attacked, take back the move and return false (illegal move)
-	if(SqAttacked(pos->kingSq[side], pos->side, pos))  {
-        TakeMove(pos);
-        return FALSE;
-    }
-
-    // Return true as a legal move
-	return TRUE;
-
+    // The side which has made the move can't have left its king in check
+    ASSERT(!SqAttacked(pos->kingSq[side], pos->side, pos));
 }
 
 /**
@@ -468,4 +498,73 @@ void TakeMove(S_BOARD *pos) {
 
 }
 
+/**
+  * @brief Function to make a null move: pass the move to the opponent
+  *
+  * @param *pos Pointer to the board structure
+  *
+  * Used by null move pruning, must not be made when in check
+  */
+void MakeNullMove(S_BOARD *pos) {
+
+    ASSERT(CheckBoard(pos));
+    ASSERT(!SqAttacked(pos->kingSq[pos->side], pos->side^1, pos));
+
+    // The pieces don't change, the NNUE accumulator only has to be copied
+    if(pos->Accumulators != NULL) {
+        NnueMakeNullMove(pos);
+    }
+
+    // Store the current position to history before making the null move
+    pos->history[pos->hisPly].posKey = pos->posKey;
+    pos->history[pos->hisPly].move = NOMOVE;
+    pos->history[pos->hisPly].fiftyMove = pos->fiftyMove;
+    pos->history[pos->hisPly].enPas = pos->enPas;
+    pos->history[pos->hisPly].castlePerm = pos->castlePerm;
+
+    // Hash out and reset the en passant square, the opponent can't capture en passant after a pass
+    if(pos->enPas != NO_SQ) {
+        HASH_EP;
+    }
+
+    pos->enPas = NO_SQ;
+
+    // Increment the ply and history ply
+    pos->hisPly++;
+    pos->ply++;
+
+    // Flip the side to move
+    pos->side ^= 1;
+    HASH_SIDE;
+
+    ASSERT(CheckBoard(pos));
+}
+
+/**
+  * @brief Function to take back a null move
+  *
+  * @param *pos Pointer to the board structure
+  */
+void TakeNullMove(S_BOARD *pos) {
+
+    ASSERT(CheckBoard(pos));
+
+    // Reduce history ply and ply
+    pos->hisPly--;
+    pos->ply--;
+
+    // Restore the en passant square from history and hash it back in
+    pos->enPas = pos->history[pos->hisPly].enPas;
+
+    if(pos->enPas != NO_SQ) {
+        HASH_EP;
+    }
+
+    // Flip the side to move
+    pos->side ^= 1;
+    HASH_SIDE;
+
+    ASSERT(CheckBoard(pos));
+}
+
 #endif // MAKEMOVE_C
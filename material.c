@@ -0,0 +1,293 @@
+/***********************************************************
+  * File Name: material.c
+  * Author: Somnath Mukherjee
+  * Description:
+  * Material Hash Table: imbalance, game phase and endgame knowledge by the piece counts
+  **********************************************************/
+
+#ifndef MATERIAL_C
+#define MATERIAL_C
+
+#include "defs.h"
+#include "stdio.h"
+
+/**
+  * Bonus for the bishop pair, and the change of a knight's and a rook's value for each own pawn
+  * more or less than five (knights like closed positions, rooks open ones)
+  */
+#define BISHOP_PAIR 40
+#define KNIGHT_PAWN_ADJUST 3
+#define ROOK_PAWN_ADJUST -6
+
+/**
+  * Score of a won King, Bishop and Knight against King ending, before driving the King to the corner
+  */
+#define KBNK_WIN 800
+
+/**
+  * @brief Function to get the distance between two squares in king moves
+  *
+  * @param sq1 64 based square
+  * @param sq2 64 based square
+  * @return The distance
+  */
+static int SqDistance(const int sq1, const int sq2) {
+	return MAX(abs((sq1 & 7) - (sq2 & 7)), abs((sq1 >> 3) - (sq2 >> 3)));
+}
+
+/**
+  * @brief Function to get the value of the pieces of a side other than pawns and the king
+  *
+  * @param *pos Pointer to the board structure
+  * @param side The side
+  * @return The value of the side's knights, bishops, rooks and queens
+  */
+static int NonPawnMaterial(const S_BOARD *pos, const int side) {
+
+	int pce = EMPTY;
+	int value = 0;
+
+	for(pce = SIDE_PCE(wN, side); pce <= SIDE_PCE(wQ, side); ++pce) {
+		value += PieceVal[pce] * pos->pceNum[pce];
+	}
+
+	return value;
+}
+
+/**
+  * @brief Function to fill a material Hash Table entry from the piece counts of a position
+  *
+  * @param *pos Pointer to the board structure
+  * @param *entry Pointer to the entry
+  */
+static void ComputeMaterial(const S_BOARD *pos, S_MATERIALENTRY *entry) {
+
+	int side = WHITE;
+	int pce = EMPTY;
+	int sign = 1;
+	int pawns = 0;
+	int minors[2];
+	int majors[2];
+	int npm[2];
+
+	entry->materialKey = pos->materialKey;
+	entry->imbalance = 0;
+	entry->phase = 0;
+	entry->endgame = ENDGAME_NONE;
+	entry->strongSide = WHITE;
+
+	// Game phase from the pieces, at most TOTAL_PHASE after promotions
+	for(pce = wP; pce <= bK; ++pce) {
+		entry->phase += PiecePhase[pce] * pos->pceNum[pce];
+	}
+
+	entry->phase = MIN(entry->phase, TOTAL_PHASE);
+
+	for(side = WHITE; side <= BLACK; ++side) {
+		sign = (side == WHITE) ? 1 : -1;
+		pawns = pos->pceNum[SIDE_PCE(wP, side)];
+
+		// Imbalance: the bishop pair, knights and rooks by the number of own pawns
+		if(pos->pceNum[SIDE_PCE(wB, side)] >= 2) {
+			entry->imbalance += sign * BISHOP_PAIR;
+		}
+
+		entry->imbalance += sign * KNIGHT_PAWN_ADJUST * (pawns - 5) * pos->pceNum[SIDE_PCE(wN, side)];
+		entry->imbalance += sign * ROOK_PAWN_ADJUST * (pawns - 5) * pos->pceNum[SIDE_PCE(wR, side)];
+
+		minors[side] = pos->pceNum[SIDE_PCE(wN, side)] + pos->pceNum[SIDE_PCE(wB, side)];
+		majors[side] = pos->pceNum[SIDE_PCE(wR, side)] + pos->pceNum[SIDE_PCE(wQ, side)];
+		npm[side] = NonPawnMaterial(pos, side);
+	}
+
+	// Without pawns, a side can only win with a clear advantage in pieces: a rook against a minor
+	// piece is drawish, a single minor piece ahead can't mate
+	for(side = WHITE; side <= BLACK; ++side) {
+		entry->scale[side] = SCALE_NORMAL;
+
+		if(pos->pceNum[SIDE_PCE(wP, side)] == 0 && npm[side] - npm[side ^ 1] <= PieceVal[wB]) {
+			entry->scale[side] = (npm[side] < PieceVal[wR]) ? 0 : SCALE_NORMAL / 4;
+		}
+	}
+
+	if(pos->pceNum[wP] == 0 && pos->pceNum[bP] == 0 && majors[WHITE] == 0 && majors[BLACK] == 0) {
+		// Dead draws: a single minor piece at most against the bare king
+		if(minors[WHITE] + minors[BLACK] <= 1) {
+			entry->endgame = ENDGAME_DRAW;
+			return;
+		}
+
+		// Only bishops: a dead draw if they all stand on one colour, which the squares tell, see MaterialDraw
+		if(pos->pceNum[wN] == 0 && pos->pceNum[bN] == 0) {
+			entry->endgame = ENDGAME_BISHOPS_ONLY;
+		}
+
+		// A minor piece each: a draw, but mate is possible, so only the evaluation says so
+		if(minors[WHITE] == 1 && minors[BLACK] == 1) {
+			entry->scale[WHITE] = 0;
+			entry->scale[BLACK] = 0;
+			return;
+		}
+
+		for(side = WHITE; side <= BLACK; ++side) {
+			// Two knights can't force mate, but the bare king can walk into one
+			if(minors[side ^ 1] == 0 && pos->pceNum[SIDE_PCE(wN, side)] == 2 && pos->pceNum[SIDE_PCE(wB, side)] == 0) {
+				entry->scale[side] = 0;
+				return;
+			}
+
+			// King, Bishop and Knight against the bare King
+			if(minors[side ^ 1] == 0 && pos->pceNum[SIDE_PCE(wN, side)] == 1 && pos->pceNum[SIDE_PCE(wB, side)] == 1) {
+				entry->endgame = ENDGAME_KBNK;
+				entry->strongSide = side;
+				return;
+			}
+		}
+	}
+
+	// A bishop each and pawns only
+	if(majors[WHITE] == 0 && majors[BLACK] == 0 && pos->pceNum[wN] == 0 && pos->pceNum[bN] == 0
+       && pos->pceNum[wB] == 1 && pos->pceNum[bB] == 1) {
+		entry->endgame = ENDGAME_BISHOPS;
+	}
+}
+
+/**
+  * @brief Function to get the material Hash Table entry of a position, computing it on a miss
+  *
+  * @param *pos Pointer to the board structure
+  * @param *scratch Entry to compute into if the board has no material Hash Table
+  * @return Pointer to the entry
+  */
+const S_MATERIALENTRY *ProbeMaterial(const S_BOARD *pos, S_MATERIALENTRY *scratch) {
+
+	S_MATERIALENTRY *entry = scratch;
+
+	if(pos->MaterialTable != NULL) {
+		entry = &pos->MaterialTable->entries[pos->materialKey & (MATERIAL_HASH_SIZE - 1)];
+
+		if(entry->materialKey == pos->materialKey) {
+			return entry;
+		}
+	}
+
+	ComputeMaterial(pos, entry);
+
+	return entry;
+}
+
+/**
+  * @brief Function to check if all the bishops on the board stand on squares of one colour
+  *
+  * @param *pos Pointer to the board structure
+  * @return TRUE if they do, FALSE otherwise
+  */
+static int BishopsOfOneColour(const S_BOARD *pos) {
+
+	int side = WHITE;
+	int pce = EMPTY;
+	int index = 0;
+	int sq = 0;
+	int colour = -1;
+
+	for(side = WHITE; side <= BLACK; ++side) {
+		pce = SIDE_PCE(wB, side);
+
+		for(index = 0; index < pos->pceNum[pce]; ++index) {
+			sq = SQ64(pos->pList[pce][index]);
+
+			if(colour == -1) {
+				colour = ((sq & 7) + (sq >> 3)) & 1;
+			} else if(colour != (((sq & 7) + (sq >> 3)) & 1)) {
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+  * @brief Function to check if neither side has enough material to mate
+  *
+  * @param *pos Pointer to the board structure
+  * @return TRUE if the position is a dead draw by material, FALSE otherwise
+  */
+int MaterialDraw(const S_BOARD *pos) {
+
+	S_MATERIALENTRY scratch[1];
+	const S_MATERIALENTRY *entry = ProbeMaterial(pos, scratch);
+
+	if(entry->endgame == ENDGAME_BISHOPS_ONLY) {
+		return BishopsOfOneColour(pos);
+	}
+
+	return entry->endgame == ENDGAME_DRAW;
+}
+
+/**
+  * @brief Function to apply the endgame knowledge of the material to an evaluation
+  *
+  * @param *pos Pointer to the board structure
+  * @param *entry Material Hash Table entry of the position
+  * @param score Evaluation from White's side
+  * @return The evaluation from White's side, scaled or replaced by the specialised evaluation
+  */
+int EvalEndgame(const S_BOARD *pos, const S_MATERIALENTRY *entry, int score) {
+
+	int strong = entry->strongSide;
+	int strongKing = 0;
+	int weakKing = 0;
+	int bishop = 0;
+	int corner = 0;
+	int bishopSq[2];
+
+	switch(entry->endgame) {
+		case ENDGAME_DRAW:
+			return 0;
+
+		case ENDGAME_KBNK:
+			strongKing = SQ64(pos->kingSq[strong]);
+			weakKing = SQ64(pos->kingSq[strong ^ 1]);
+			bishop = SQ64(pos->pList[SIDE_PCE(wB, strong)][0]);
+
+			// Mate is only possible in a corner of the bishop's colour: a1 and h8 for the dark squares
+			if((((bishop & 7) + (bishop >> 3)) & 1) == 0) {
+				corner = MIN(SqDistance(weakKing, 0), SqDistance(weakKing, 63));
+			} else {
+				corner = MIN(SqDistance(weakKing, 7), SqDistance(weakKing, 56));
+			}
+
+			score = KBNK_WIN + 30 * (7 - corner) + 10 * (7 - SqDistance(strongKing, weakKing));
+
+			return (strong == WHITE) ? score : -score;
+
+		case ENDGAME_BISHOPS:
+			bishopSq[WHITE] = SQ64(pos->pList[wB][0]);
+			bishopSq[BLACK] = SQ64(pos->pList[bB][0]);
+
+			// Opposite coloured bishops halve the score
+			if(((bishopSq[WHITE] & 7) + (bishopSq[WHITE] >> 3) + (bishopSq[BLACK] & 7) + (bishopSq[BLACK] >> 3)) & 1) {
+				score /= 2;
+			}
+			break;
+
+		case ENDGAME_BISHOPS_ONLY:
+			if(BishopsOfOneColour(pos)) {
+				return 0;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	// Scale the score of the side which is ahead
+	if(score > 0) {
+		return score * entry->scale[WHITE] / SCALE_NORMAL;
+	}
+
+	return score * entry->scale[BLACK] / SCALE_NORMAL;
+}
+
+#endif // MATERIAL_C
@@ -16,48 +16,11 @@
 
 /*
 MoveGen(board, list)
-    Loop all pieces
-        -> If slider, then loop each direction and add move
+    Loop all pieces of the side by their Bit Boards
+        -> Get the attacks of the piece (magic bitboards for sliders) and mask them with the target squares
             -> AddMove list->moves[list->count] = move; list->count++;
 */
 
-const int LoopSlidePce[8] = {
- wB, wR, wQ, 0, bB, bR, bQ, 0
-};
-
-const int LoopNonSlidePce[6] = {
- wN, wK, 0, bN, bK, 0
-};
-
-const int LoopSlideIndex[2] = { 0, 4 };
-const int LoopNonSlideIndex[2] = { 0, 3 };
-
-/**
-  * Directions and square offsets each piece can move to.Note: This array is not used for pawns
-  */
-const int PceDir[NUM_PIECES][8] = {
-	{ 0, 0, 0, 0, 0, 0, 0 },
-	{ 0, 0, 0, 0, 0, 0, 0 },
-	{ -8, -19,	-21, -12, 8, 19, 21, 12 },
-	{ -9, -11, 11, 9, 0, 0, 0, 0 },
-	{ -1, -10,	1, 10, 0, 0, 0, 0 },
-	{ -1, -10,	1, 10, -9, -11, 11, 9 },
-	{ -1, -10,	1, 10, -9, -11, 11, 9 },
-	{ 0, 0, 0, 0, 0, 0, 0 },
-	{ -8, -19,	-21, -12, 8, 19, 21, 12 },
-	{ -9, -11, 11, 9, 0, 0, 0, 0 },
-	{ -1, -10,	1, 10, 0, 0, 0, 0 },
-	{ -1, -10,	1, 10, -9, -11, 11, 9 },
-	{ -1, -10,	1, 10, -9, -11, 11, 9 }
-};
-
-/**
-  * Number of directions that each piece can move to. Note: This array is not used for pawns
-  */
-const int NumDir[NUM_PIECES] = {
- 0, 0, 8, 4, 4, 8, 8, 0, 8, 4, 4, 8, 8
-};
-
 /*
 Search PV Move
 Search Captures: MVVLVA (Most Valuable Victim, Least Valuable Valuable Attacker) or SEE (Static Exchange Evaluator)
@@ -103,31 +66,8 @@ int InitMvvLva() {
   * @param *pos Pointer to the board structure
   * @param move The move
   */
-int MoveExists(S_BOARD *pos, const int move) {
-
-	S_MOVELIST list[1];
-	// Generate all the moves
-    GenerateAllMoves(pos,list);
-
-    int moveNum = 0;
-    // Loop through all the moves
-	for(moveNum = 0; moveNum < list->count; ++moveNum) {
-        // Make the move. If invalid move, ignore and continue
-        if (!MakeMove(pos,list->moves[moveNum].move))  {
-            continue;
-        }
-
-        // Take back move
-        TakeMove(pos);
-
-        // Check if the move is same, return true
-		if(list->moves[moveNum].move == move) {
-			return TRUE;
-		}
-    }
-
-    // If the move is not found, return false
-	return FALSE;
+int MoveExists(const S_BOARD *pos, const int move) {
+	return MoveIsLegal(pos, move);
 }
 
 
@@ -288,395 +228,690 @@ static void AddBlackPawnMove(const S_BOARD *pos, const int from, const int to, S
 }
 
 /**
-  * Function to generate all moves
+  * Function to check if a castling is allowed: the permission is there, the squares between
+  * the king and the rook are empty and the king doesn't pass through an attacked square
   *
   * @param *pos Pointer to the board structure
-  * @param *list Pointer to the move list
+  * @param castle The castling: WKCA, WQCA, BKCA or BQCA
+  * @return TRUE if the castling is allowed, FALSE otherwise
   */
-void GenerateAllMoves(const S_BOARD *pos, S_MOVELIST *list) {
+static int CanCastle(const S_BOARD *pos, const int castle) {
 
-	ASSERT(CheckBoard(pos));
+	if(!(pos->castlePerm & castle)) {
+		return FALSE;
+	}
 
-	list->count = 0;
+	switch(castle) {
+		case WKCA:
+			return pos->pieces[F1] == EMPTY && pos->pieces[G1] == EMPTY
+                && !SqAttacked(E1,BLACK,pos) && !SqAttacked(F1,BLACK,pos) && !SqAttacked(G1,BLACK,pos);
+		case WQCA:
+			return pos->pieces[D1] == EMPTY && pos->pieces[C1] == EMPTY && pos->pieces[B1] == EMPTY
+                && !SqAttacked(E1,BLACK,pos) && !SqAttacked(D1,BLACK,pos) && !SqAttacked(C1,BLACK,pos);
+		case BKCA:
+			return pos->pieces[F8] == EMPTY && pos->pieces[G8] == EMPTY
+                && !SqAttacked(E8,WHITE,pos) && !SqAttacked(F8,WHITE,pos) && !SqAttacked(G8,WHITE,pos);
+		case BQCA:
+			return pos->pieces[D8] == EMPTY && pos->pieces[C8] == EMPTY && pos->pieces[B8] == EMPTY
+                && !SqAttacked(E8,WHITE,pos) && !SqAttacked(D8,WHITE,pos) && !SqAttacked(C8,WHITE,pos);
+		default:
+			return FALSE;
+	}
+}
+
+/**
+  * Function to find the checks and the pins of the side to move
+  *
+  * @param *pos Pointer to the board structure
+  * @param *checkInfo Pointer to the check information to fill
+  */
+void InitCheckInfo(const S_BOARD *pos, S_CHECKINFO *checkInfo) {
 
-	int pce = EMPTY;
 	int side = pos->side;
-	int sq = 0;
-	int t_sq = 0;
-	int pceNum = 0;
-	int dir = 0;
-	int index = 0;
-	int pceIndex = 0;
+	int ksq64 = SQ64(pos->kingSq[side]);
+	int sq64 = 0;
+	U64 occ = pos->occupancy[BOTH];
+	U64 enemy = pos->occupancy[side ^ 1];
+	U64 snipers = 0ULL;
+	U64 blockers = 0ULL;
+
+	checkInfo->kingSq64 = ksq64;
+	checkInfo->checkers = AttackersTo(pos, ksq64, occ) & enemy;
+	checkInfo->pinned = 0ULL;
+
+    // Enemy sliders on a line with the king pin an own piece if it's the only piece between them
+	snipers = (ROOK_ATTACKS(ksq64, 0ULL) & (pos->pieceBB[SIDE_PCE(wR, side ^ 1)] | pos->pieceBB[SIDE_PCE(wQ, side ^ 1)]))
+            | (BISHOP_ATTACKS(ksq64, 0ULL) & (pos->pieceBB[SIDE_PCE(wB, side ^ 1)] | pos->pieceBB[SIDE_PCE(wQ, side ^ 1)]));
+
+	while(snipers) {
+		sq64 = POP(&snipers);
+		blockers = BetweenBB[ksq64][sq64] & occ;
+
+		if(blockers && !(blockers & (blockers - 1)) && (blockers & pos->occupancy[side])) {
+			checkInfo->pinned |= blockers;
+		}
+	}
 
-	//printf("\n\nSide:%d\n",side);
+    // Not in check: any square; single check: capture or block the checker; double check: only the king moves
+	if(!checkInfo->checkers) {
+		checkInfo->checkMask = ~0ULL;
+	} else if(!(checkInfo->checkers & (checkInfo->checkers - 1))) {
+		blockers = checkInfo->checkers;
+		sq64 = POP(&blockers);
+		checkInfo->checkMask = checkInfo->checkers | BetweenBB[ksq64][sq64];
+	} else {
+		checkInfo->checkMask = 0ULL;
+	}
+}
 
-    // White to move
-	if(side == WHITE) {
-        // Generate White Pawn Moves
-        // Loop through each of the white pawns on the board
-		for(pceNum = 0; pceNum < pos->pceNum[wP]; ++pceNum) {
-		    // Find which square the pawn is on
-			sq = pos->pList[wP][pceNum];
-			ASSERT(SqOnBoard(sq));
-
-            // If the square above the pawn's square if empty
-			if(pos->pieces[sq + 10] == EMPTY) {
-				AddWhitePawnMove(pos, sq, sq + 10, list);
-
-				// If the pawn is on the second rank (starting position) and
-				// the square two squares above is also empty, it can move two squares
-				if(RanksBrd[sq] == RANK_2 && pos->pieces[sq + 20] == EMPTY) {
-					AddQuietMove(pos, MOVE(sq, (sq + 20), EMPTY, EMPTY, MFLAGPS), list);
-				}
-			}
+/**
+  * Function to restrict the target squares of a piece to the legal ones
+  *
+  * @param *pos Pointer to the board structure
+  * @param *checkInfo Pointer to the check information of the position
+  * @param pce The piece
+  * @param sq64 64 based square of the piece
+  * @param targets Bit Board of the target squares
+  * @return Bit Board of the target squares which don't leave the king in check
+  */
+static U64 LegalTargets(const S_BOARD *pos, const S_CHECKINFO *checkInfo, const int pce, const int sq64, U64 targets) {
 
-            // If there is a black piece sitting on the square diagonally left of the pawn's square, the pawn can capture it
-			if(!SQOFFBOARD(sq + 9) && PieceCol[pos->pieces[sq + 9]] == BLACK) {
-				AddWhitePawnCapMove(pos, sq, sq + 9, pos->pieces[sq + 9], list);
+	int t_sq64 = 0;
+	U64 legal = 0ULL;
+	U64 occ = 0ULL;
+
+	if(PieceKing[pce]) {
+        // The king can't step onto an attacked square, sliders see through the square it leaves
+		occ = pos->occupancy[BOTH] ^ SetMask[sq64];
+
+		while(targets) {
+			t_sq64 = POP(&targets);
+
+			if(!(AttackersTo(pos, t_sq64, occ) & pos->occupancy[pos->side ^ 1])) {
+				legal |= SetMask[t_sq64];
 			}
+		}
+
+		return legal;
+	}
+
+    // Other pieces must resolve a check, and a pinned piece must stay on the line of the pin
+	targets &= checkInfo->checkMask;
+
+	if(checkInfo->pinned & SetMask[sq64]) {
+		targets &= LineBB[checkInfo->kingSq64][sq64];
+	}
+
+	return targets;
+}
+
+/**
+  * Function to check if an en passant capture is legal
+  * Both pawns leave their rank, so the capture is tested on the occupancy after the move
+  *
+  * @param *pos Pointer to the board structure
+  * @param *checkInfo Pointer to the check information of the position
+  * @param from 64 based square of the capturing pawn
+  * @return TRUE if the king isn't attacked after the capture, FALSE otherwise
+  */
+static int EnPassantIsLegal(const S_BOARD *pos, const S_CHECKINFO *checkInfo, const int from) {
+
+	int to = SQ64(pos->enPas);
+	int captured = (pos->side == WHITE) ? to - 8 : to + 8;
+	U64 occ = (pos->occupancy[BOTH] ^ SetMask[from] ^ SetMask[captured]) | SetMask[to];
 
-			// If there is a black piece sitting on the square diagonally right of the pawn's square, the pawn can capture it
-			if(!SQOFFBOARD(sq + 11) && PieceCol[pos->pieces[sq + 11]] == BLACK) {
-				AddWhitePawnCapMove(pos, sq, sq + 11, pos->pieces[sq + 11], list);
+	return (AttackersTo(pos, checkInfo->kingSq64, occ) & pos->occupancy[pos->side ^ 1] & occ) ? FALSE : TRUE;
+}
+
+/**
+  * Function to add all captures of the side to move, including en passant and capture promotions
+  *
+  * @param *pos Pointer to the board structure
+  * @param *checkInfo Pointer to the check information of the position
+  * @param *list Pointer to the move list
+  */
+static void AddAllCaps(const S_BOARD *pos, const S_CHECKINFO *checkInfo, S_MOVELIST *list) {
+
+	int side = pos->side;
+	int pce = EMPTY;
+	int sq64 = 0;
+	int t_sq64 = 0;
+	U64 enemy = pos->occupancy[side ^ 1];
+	U64 pieces = 0ULL;
+	U64 attacks = 0ULL;
+
+    // Pawns capture the enemy pieces they attack, and en passant
+	pieces = pos->pieceBB[SIDE_PCE(wP, side)];
+
+	while(pieces) {
+		sq64 = POP(&pieces);
+		attacks = LegalTargets(pos, checkInfo, SIDE_PCE(wP, side), sq64, PawnAttacks[side][sq64] & enemy);
+
+		while(attacks) {
+			t_sq64 = POP(&attacks);
+
+			if(side == WHITE) {
+				AddWhitePawnCapMove(pos, SQ120(sq64), SQ120(t_sq64), pos->pieces[SQ120(t_sq64)], list);
+			} else {
+				AddBlackPawnCapMove(pos, SQ120(sq64), SQ120(t_sq64), pos->pieces[SQ120(t_sq64)], list);
 			}
+		}
 
-            if(pos->enPas != NO_SQ) {
-                // Add en passant capture left, if one is available
-                if(sq + 9 == pos->enPas) {
-                    AddEnPassantMove(pos, MOVE(sq, sq + 9, EMPTY, EMPTY, MFLAGEP), list);
-                }
-
-                // Add en passant capture right, if one is available
-                if(sq + 11 == pos->enPas) {
-                    AddEnPassantMove(pos, MOVE(sq, sq + 11, EMPTY, EMPTY, MFLAGEP), list);
-                }
-            }
+		if(pos->enPas != NO_SQ && IS_SET_64(PawnAttacks[side][sq64], SQ64(pos->enPas))
+           && EnPassantIsLegal(pos, checkInfo, sq64)) {
+			AddEnPassantMove(pos, MOVE(SQ120(sq64), pos->enPas, EMPTY, EMPTY, MFLAGEP), list);
 		}
+	}
 
-		// Castling for White
-		// White king-side castling is allowed?
-		if(pos->castlePerm & WKCA) {
-            // If there is no piece on the f1 and g1 square
-			if(pos->pieces[F1] == EMPTY && pos->pieces[G1] == EMPTY) {
-			    // If e1, f1 and g1 are not attacked by Black
-				if(!SqAttacked(E1,BLACK,pos) && !SqAttacked(F1,BLACK,pos) && !SqAttacked(G1,BLACK,pos)) {
-				    // Generate White king-side castling
-					//printf("WKCA MoveGen\n");
-					AddQuietMove(pos, MOVE(E1, G1, EMPTY, EMPTY, MFLAGCA), list);
-				}
+    // Knights, Bishops, Rooks, Queens and the King capture the enemy pieces they attack
+	for(pce = SIDE_PCE(wN, side); pce <= SIDE_PCE(wK, side); ++pce) {
+		pieces = pos->pieceBB[pce];
+
+		while(pieces) {
+			sq64 = POP(&pieces);
+			attacks = LegalTargets(pos, checkInfo, pce, sq64, AttacksFrom(pce, sq64, pos->occupancy[BOTH]) & enemy);
+
+			while(attacks) {
+				t_sq64 = POP(&attacks);
+				AddCaptureMove(pos, MOVE(SQ120(sq64), SQ120(t_sq64), pos->pieces[SQ120(t_sq64)], EMPTY, 0), list);
 			}
 		}
+	}
+}
 
-        // White queen-side castling is allowed?
-		if(pos->castlePerm & WQCA) {
-            // If there is no piece on the d1, c1 and b1 square
-			if(pos->pieces[D1] == EMPTY && pos->pieces[C1] == EMPTY && pos->pieces[B1] == EMPTY) {
-			    // If e1, d1 and c1 are not attacked by Black
-				if(!SqAttacked(E1,BLACK,pos) && !SqAttacked(D1,BLACK,pos) && !SqAttacked(C1,BLACK,pos)) {
-				    // Generate White queen-side castling
-					//printf("WQCA MoveGen\n");
-					AddQuietMove(pos, MOVE(E1, C1, EMPTY, EMPTY, MFLAGCA), list);
-				}
+/**
+  * Function to add all quiet moves of the side to move: pawn pushes, promotions without capture,
+  * castling and piece moves to empty squares
+  *
+  * @param *pos Pointer to the board structure
+  * @param *checkInfo Pointer to the check information of the position
+  * @param *list Pointer to the move list
+  */
+static void AddAllQuiets(const S_BOARD *pos, const S_CHECKINFO *checkInfo, S_MOVELIST *list) {
+
+	int side = pos->side;
+	int pce = EMPTY;
+	int sq64 = 0;
+	int t_sq64 = 0;
+	U64 empty = ~pos->occupancy[BOTH];
+	U64 pieces = 0ULL;
+	U64 attacks = 0ULL;
+	U64 pushes = 0ULL;
+	U64 doublePushes = 0ULL;
+
+	if(side == WHITE) {
+        // Pawns push one square up to an empty square, and from the second rank two squares up
+		pushes = (pos->pieceBB[wP] << 8) & empty;
+		doublePushes = ((pushes & THIRD_RANK_64) << 8) & empty & checkInfo->checkMask;
+		pushes &= checkInfo->checkMask;
+
+		while(pushes) {
+			t_sq64 = POP(&pushes);
+
+			if(LegalTargets(pos, checkInfo, wP, t_sq64 - 8, SetMask[t_sq64])) {
+				AddWhitePawnMove(pos, SQ120(t_sq64 - 8), SQ120(t_sq64), list);
 			}
 		}
-	} else {
-	    // Generate Black Pawn Moves
-        // Loop through each of the black pawns on the board
-        for(pceNum = 0; pceNum < pos->pceNum[bP]; ++pceNum) {
-            // Find which square the pawn is on
-			sq = pos->pList[bP][pceNum];
-			ASSERT(SqOnBoard(sq));
-
-            // If the square above the pawn's square if empty
-			if(pos->pieces[sq - 10] == EMPTY) {
-				AddBlackPawnMove(pos, sq, sq-10, list);
-
-				// If the pawn is on the second rank (starting position) and
-				// the square two squares above is also empty, it can move two squares
-				if(RanksBrd[sq] == RANK_7 && pos->pieces[sq - 20] == EMPTY) {
-					AddQuietMove(pos, MOVE(sq, (sq - 20), EMPTY, EMPTY, MFLAGPS),list);
-				}
+
+		while(doublePushes) {
+			t_sq64 = POP(&doublePushes);
+
+			if(!LegalTargets(pos, checkInfo, wP, t_sq64 - 16, SetMask[t_sq64])) {
+				continue;
 			}
 
-            // If there is a black piece sitting on the square diagonally left of the pawn's square, the pawn can capture it
-			if(!SQOFFBOARD(sq - 9) && PieceCol[pos->pieces[sq - 9]] == WHITE) {
-				AddBlackPawnCapMove(pos, sq, sq - 9, pos->pieces[sq - 9], list);
+			AddQuietMove(pos, MOVE(SQ120(t_sq64 - 16), SQ120(t_sq64), EMPTY, EMPTY, MFLAGPS), list);
+		}
+
+        // Castling for White
+		if(CanCastle(pos, WKCA)) {
+			AddQuietMove(pos, MOVE(E1, G1, EMPTY, EMPTY, MFLAGCA), list);
+		}
+
+		if(CanCastle(pos, WQCA)) {
+			AddQuietMove(pos, MOVE(E1, C1, EMPTY, EMPTY, MFLAGCA), list);
+		}
+	} else {
+        // Pawns push one square down to an empty square, and from the seventh rank two squares down
+		pushes = (pos->pieceBB[bP] >> 8) & empty;
+		doublePushes = ((pushes & SIXTH_RANK_64) >> 8) & empty & checkInfo->checkMask;
+		pushes &= checkInfo->checkMask;
+
+		while(pushes) {
+			t_sq64 = POP(&pushes);
+
+			if(LegalTargets(pos, checkInfo, bP, t_sq64 + 8, SetMask[t_sq64])) {
+				AddBlackPawnMove(pos, SQ120(t_sq64 + 8), SQ120(t_sq64), list);
 			}
+		}
+
+		while(doublePushes) {
+			t_sq64 = POP(&doublePushes);
 
-            // If there is a black piece sitting on the square diagonally right of the pawn's square, the pawn can capture it
-			if(!SQOFFBOARD(sq - 11) && PieceCol[pos->pieces[sq - 11]] == WHITE) {
-				AddBlackPawnCapMove(pos, sq, sq - 11, pos->pieces[sq - 11], list);
+			if(!LegalTargets(pos, checkInfo, bP, t_sq64 + 16, SetMask[t_sq64])) {
+				continue;
 			}
 
-            if(pos->enPas != NO_SQ) {
-                // Add en passant capture left, if one is available
-                if(sq - 9 == pos->enPas) {
-                    AddEnPassantMove(pos, MOVE(sq, sq - 9, EMPTY, EMPTY, MFLAGEP), list);
-                }
-
-                // Add en passant capture right, if one is available
-                if(sq - 11 == pos->enPas) {
-                    AddEnPassantMove(pos, MOVE(sq, sq - 11, EMPTY, EMPTY, MFLAGEP), list);
-                }
-            }
+			AddQuietMove(pos, MOVE(SQ120(t_sq64 + 16), SQ120(t_sq64), EMPTY, EMPTY, MFLAGPS), list);
 		}
 
         // Castling for Black
-        // Black king-side castling is allowed?
-		if(pos->castlePerm & BKCA) {
-            // If there is no piece on the f8 and g8 square
-			if(pos->pieces[F8] == EMPTY && pos->pieces[G8] == EMPTY) {
-			    // If e8, f8 and g8 are not attacked by Black
-				if(!SqAttacked(E8,WHITE,pos) && !SqAttacked(F8,WHITE,pos) && !SqAttacked(G8,WHITE,pos)) {
-				    // Generate Black king-side castling
-					//printf("BKCA MoveGen\n");
-					AddQuietMove(pos, MOVE(E8, G8, EMPTY, EMPTY, MFLAGCA), list);
-				}
-			}
+		if(CanCastle(pos, BKCA)) {
+			AddQuietMove(pos, MOVE(E8, G8, EMPTY, EMPTY, MFLAGCA), list);
 		}
 
-        // Black queen-side castling is allowed?
-		if(pos->castlePerm &  BQCA) {
-            // If there is no piece on the d8, c8 and b8 square
-			if(pos->pieces[D8] == EMPTY && pos->pieces[C8] == EMPTY && pos->pieces[B8] == EMPTY) {
-                // If e8, d8 and c8 are not attacked by Black
-				if(!SqAttacked(E8,WHITE,pos) && !SqAttacked(D8,WHITE,pos) && !SqAttacked(C8,WHITE,pos)) {
-				    // Generate Black queen-side castling
-					//printf("BQCA MoveGen\n");
-					AddQuietMove(pos, MOVE(E8, C8, EMPTY, EMPTY, MFLAGCA), list);
-				}
-			}
+		if(CanCastle(pos, BQCA)) {
+			AddQuietMove(pos, MOVE(E8, C8, EMPTY, EMPTY, MFLAGCA), list);
 		}
 	}
 
-	/* Loop for slide pieces */
-	pceIndex = LoopSlideIndex[side];
-	pce = LoopSlidePce[pceIndex++];
-
-	while( pce != 0) {
-		ASSERT(PieceValid(pce));
-		//printf("sliders pceIndex:%d pce:%d\n", pceIndex, pce);
-
-        // Loop through each of the current piece of that type on the board
-		for(pceNum = 0; pceNum < pos->pceNum[pce]; ++pceNum) {
-            // Find which square the piece is on
-			sq = pos->pList[pce][pceNum];
-			ASSERT(SqOnBoard(sq));
-
-			//printf("Piece:%c on %s\n", PceChar[pce], PrSq(sq));
-
-            // Loop through all the directions for the current piece
-			for(index = 0; index < NumDir[pce]; ++index) {
-                // Get the current direction
-				dir = PceDir[pce][index];
-				t_sq = sq + dir;
-
-                // Slide until it goes off-board or hits another piece
-				while(!SQOFFBOARD(t_sq)) {
-                    // If it encounters a piece
-					// Find other side: BLACK ^ 1 == WHITE, WHITE ^ 1 == BLACK
-					if(pos->pieces[t_sq] != EMPTY) {
-					    // If the piece on the target square is of the other side
-						if( PieceCol[pos->pieces[t_sq]] == (side ^ 1)) {
-						    // Generate a capture move
-							//printf("\t\tCapture on %s\n", PrSq(t_sq));
-							AddCaptureMove(pos, MOVE(sq, t_sq, pos->pieces[t_sq], EMPTY, 0), list);
-						}
-
-                        // Stop sliding
-						break;
-					}
-
-					// Otherwise generate a normal move
-					//printf("\t\tNormal on %s\n", PrSq(t_sq));
-					AddQuietMove(pos, MOVE(sq, t_sq, EMPTY, EMPTY, 0), list);
-
-					// Continue sliding
-					t_sq += dir;
-				}
+    // Knights, Bishops, Rooks, Queens and the King move to the empty squares they attack
+	for(pce = SIDE_PCE(wN, side); pce <= SIDE_PCE(wK, side); ++pce) {
+		pieces = pos->pieceBB[pce];
+
+		while(pieces) {
+			sq64 = POP(&pieces);
+			attacks = LegalTargets(pos, checkInfo, pce, sq64, AttacksFrom(pce, sq64, pos->occupancy[BOTH]) & empty);
+
+			while(attacks) {
+				t_sq64 = POP(&attacks);
+				AddQuietMove(pos, MOVE(SQ120(sq64), SQ120(t_sq64), EMPTY, EMPTY, 0), list);
 			}
 		}
-
-		pce = LoopSlidePce[pceIndex++];
 	}
+}
 
-	/* Loop for non slide */
-	pceIndex = LoopNonSlideIndex[side];
-	pce = LoopNonSlidePce[pceIndex++];
+/**
+  * Function to generate all moves
+  *
+  * @param *pos Pointer to the board structure
+  * @param *list Pointer to the move list
+  */
+void GenerateAllMoves(const S_BOARD *pos, S_MOVELIST *list) {
 
-	while( pce != 0) {
-		ASSERT(PieceValid(pce));
-		//printf("non sliders pceIndex:%d pce:%d\n", pceIndex, pce);
+	ASSERT(CheckBoard(pos));
 
-        // Loop through each of the current piece of that type on the board
-		for(pceNum = 0; pceNum < pos->pceNum[pce]; ++pceNum) {
-            // Find which square the piece is on
-			sq = pos->pList[pce][pceNum];
-			ASSERT(SqOnBoard(sq));
+	S_CHECKINFO checkInfo[1];
+	InitCheckInfo(pos, checkInfo);
 
-			//printf("Piece:%c on %s\n", PceChar[pce], PrSq(sq));
+	list->count = 0;
 
-            // Loop through all the directions for the current piece
-			for(index = 0; index < NumDir[pce]; ++index) {
-                // Get the current direction
-				dir = PceDir[pce][index];
-                // Find the target square
-				t_sq = sq + dir;
+	AddAllCaps(pos, checkInfo, list);
+	AddAllQuiets(pos, checkInfo, list);
+}
 
-                // Skip if the target square is off-board
-				if(SQOFFBOARD(t_sq)) {
-					continue;
-				}
+/**
+  * Function to generate all capture moves
+  *
+  * @param *pos Pointer to the board structure
+  * @param *list Pointer to the move list
+  */
+void GenerateAllCaps(const S_BOARD *pos, S_MOVELIST *list) {
 
-                // If there is a piece on the target square
-				// Find other side: BLACK ^ 1 == WHITE, WHITE ^ 1 == BLACK
-				if(pos->pieces[t_sq] != EMPTY) {
-                    // If the piece on the target square is of the other side
-					if(PieceCol[pos->pieces[t_sq]] == (side ^ 1)) {
-					    // Generate a capture move
-						//printf("\t\tCapture on %s\n", PrSq(t_sq));
-						AddCaptureMove(pos, MOVE(sq, t_sq, pos->pieces[t_sq], EMPTY, 0), list);
-					}
-
-					continue;
-				}
+	ASSERT(CheckBoard(pos));
 
-				// If the target square is empty, generate a normal move
-				//printf("\t\tNormal on %s\n", PrSq(t_sq));
-				AddQuietMove(pos, MOVE(sq, t_sq, EMPTY, EMPTY, 0), list);
-			}
-		}
+	S_CHECKINFO checkInfo[1];
+	InitCheckInfo(pos, checkInfo);
 
-		pce = LoopNonSlidePce[pceIndex++];
-	}
+	list->count = 0;
+
+	AddAllCaps(pos, checkInfo, list);
 }
 
 /**
-  * Function to generate all capture moves
+  * Function to generate all quiet moves: pawn pushes, promotions without capture, castling
+  * and piece moves to empty squares
   *
   * @param *pos Pointer to the board structure
   * @param *list Pointer to the move list
   */
-void GenerateAllCaps(const S_BOARD *pos, S_MOVELIST *list) {
+void GenerateAllQuiets(const S_BOARD *pos, S_MOVELIST *list) {
 
 	ASSERT(CheckBoard(pos));
 
+	S_CHECKINFO checkInfo[1];
+	InitCheckInfo(pos, checkInfo);
+
 	list->count = 0;
 
-	int pce = EMPTY;
+	AddAllQuiets(pos, checkInfo, list);
+}
+
+/**
+  * Function to check if a move, e.g. from the Hash Table or a killer slot, can be played in the current position
+  * The move must be exactly as the move generator would encode it; the king may still be left in check
+  *
+  * @param *pos Pointer to the board structure
+  * @param move The move
+  * @return TRUE if the move is pseudo-legal, FALSE otherwise
+  */
+int MoveIsPseudoLegal(const S_BOARD *pos, const int move) {
+
+	int from = FROMSQ(move);
+	int to = TOSQ(move);
 	int side = pos->side;
-	int sq = 0; int t_sq = 0;
-	int pceNum = 0;
+	int pce = EMPTY;
+	int captured = CAPTURED(move);
+	int promoted = PROMOTED(move);
 	int dir = 0;
-	int index = 0;
-	int pceIndex = 0;
 
-	if(side == WHITE) {
+	if(move == NOMOVE || SQOFFBOARD(from) || SQOFFBOARD(to)) {
+		return FALSE;
+	}
 
-		for(pceNum = 0; pceNum < pos->pceNum[wP]; ++pceNum) {
-			sq = pos->pList[wP][pceNum];
-			ASSERT(SqOnBoard(sq));
+	// A piece of the side to move must stand on the from square
+	pce = pos->pieces[from];
 
-			if(!SQOFFBOARD(sq + 9) && PieceCol[pos->pieces[sq + 9]] == BLACK) {
-				AddWhitePawnCapMove(pos, sq, sq+9, pos->pieces[sq + 9], list);
-			}
-			if(!SQOFFBOARD(sq + 11) && PieceCol[pos->pieces[sq + 11]] == BLACK) {
-				AddWhitePawnCapMove(pos, sq, sq+11, pos->pieces[sq + 11], list);
-			}
+	if(pce == EMPTY || PieceCol[pce] != side) {
+		return FALSE;
+	}
 
-			if(pos->enPas != NO_SQ) {
-				if(sq + 9 == pos->enPas) {
-					AddEnPassantMove(pos, MOVE(sq,sq + 9,EMPTY,EMPTY,MFLAGEP), list);
-				}
-				if(sq + 11 == pos->enPas) {
-					AddEnPassantMove(pos, MOVE(sq,sq + 11,EMPTY,EMPTY,MFLAGEP), list);
-				}
-			}
+	// Castling: the same conditions as in the move generator
+	if(move & MFLAGCA) {
+		if(side == WHITE && from == E1 && pce == wK) {
+			return (to == G1 && CanCastle(pos, WKCA)) || (to == C1 && CanCastle(pos, WQCA));
 		}
-	} else {
 
-		for(pceNum = 0; pceNum < pos->pceNum[bP]; ++pceNum) {
-			sq = pos->pList[bP][pceNum];
-			ASSERT(SqOnBoard(sq));
+		if(side == BLACK && from == E8 && pce == bK) {
+			return (to == G8 && CanCastle(pos, BKCA)) || (to == C8 && CanCastle(pos, BQCA));
+		}
+
+		return FALSE;
+	}
 
-			if(!SQOFFBOARD(sq - 9) && PieceCol[pos->pieces[sq - 9]] == WHITE) {
-				AddBlackPawnCapMove(pos, sq, sq-9, pos->pieces[sq - 9], list);
+	// The captured piece must be the opponent's piece on the to square (EMPTY for a quiet move)
+	if(pos->pieces[to] != captured || (captured != EMPTY && PieceCol[captured] != (side ^ 1))) {
+		return FALSE;
+	}
+
+	if(PiecePawn[pce]) {
+		dir = (side == WHITE) ? 10 : -10;
+
+		// En passant captures onto the en passant square
+		if(move & MFLAGEP) {
+			return to == pos->enPas && (to == from + dir - 1 || to == from + dir + 1) && promoted == EMPTY;
+		}
+
+		// A pawn reaching the last rank must promote, to a piece of its own colour
+		if(RanksBrd[to] == (side == WHITE ? RANK_8 : RANK_1)) {
+			if(promoted == EMPTY || PieceCol[promoted] != side || PiecePawn[promoted] || PieceKing[promoted]) {
+				return FALSE;
 			}
+		} else if(promoted != EMPTY) {
+			return FALSE;
+		}
+
+		if(captured != EMPTY) {
+			return (to == from + dir - 1 || to == from + dir + 1) && !(move & MFLAGPS);
+		}
+
+		if(move & MFLAGPS) {
+			return to == from + 2 * dir && RanksBrd[from] == (side == WHITE ? RANK_2 : RANK_7)
+                && pos->pieces[from + dir] == EMPTY;
+		}
+
+		return to == from + dir;
+	}
+
+	// Only pawns promote, make pawn start moves or capture en passant
+	if(promoted != EMPTY || (move & (MFLAGPS | MFLAGEP))) {
+		return FALSE;
+	}
+
+	// The piece must attack the to square
+	return IS_SET_64(AttacksFrom(pce, SQ64(from), pos->occupancy[BOTH]), SQ64(to)) ? TRUE : FALSE;
+}
+
+/**
+  * Function to check if a pseudo-legal move doesn't leave the king in check
+  *
+  * @param *pos Pointer to the board structure
+  * @param *checkInfo Pointer to the check information of the position
+  * @param move The pseudo-legal move
+  * @return TRUE if the move is legal, FALSE otherwise
+  */
+static int PseudoLegalIsLegal(const S_BOARD *pos, const S_CHECKINFO *checkInfo, const int move) {
+
+	int from64 = SQ64(FROMSQ(move));
+	int to64 = SQ64(TOSQ(move));
+
+	// Castling is only pseudo-legal when the king doesn't pass through an attacked square
+	if(move & MFLAGCA) {
+		return TRUE;
+	}
+
+	if(move & MFLAGEP) {
+		return EnPassantIsLegal(pos, checkInfo, from64);
+	}
+
+	return LegalTargets(pos, checkInfo, pos->pieces[FROMSQ(move)], from64, SetMask[to64]) ? TRUE : FALSE;
+}
+
+/**
+  * Function to check if a move, e.g. from the Hash Table or a killer slot, is legal in the current position
+  *
+  * @param *pos Pointer to the board structure
+  * @param move The move
+  * @return TRUE if the move is legal, FALSE otherwise
+  */
+int MoveIsLegal(const S_BOARD *pos, const int move) {
+
+	S_CHECKINFO checkInfo[1];
+
+	if(!MoveIsPseudoLegal(pos, move)) {
+		return FALSE;
+	}
+
+	InitCheckInfo(pos, checkInfo);
+
+	return PseudoLegalIsLegal(pos, checkInfo, move);
+}
+
+/**
+  * Function to pick the best scored move of a move list from the given index on
+  * Swaps it to the index, so the moves before the index are the ones already picked
+  *
+  * @param *list Pointer to the move list
+  * @param index Index of the next move
+  */
+static void PickBestMove(S_MOVELIST *list, const int index) {
+
+	S_MOVE temp;
+	int moveNum = 0;
+	int bestNum = index;
+
+	for(moveNum = index + 1; moveNum < list->count; ++moveNum) {
+		if(list->moves[moveNum].score > list->moves[bestNum].score) {
+			bestNum = moveNum;
+		}
+	}
+
+	temp = list->moves[index];
+	list->moves[index] = list->moves[bestNum];
+	list->moves[bestNum] = temp;
+}
+
+/**
+  * Function to sort a move list by score, highest first
+  * Insertion sort: the quiet move lists are short and partly ordered by the generator
+  *
+  * @param *list Pointer to the move list
+  */
+static void SortMoves(S_MOVELIST *list) {
+
+	S_MOVE temp;
+	int moveNum = 0;
+	int index = 0;
+
+	for(moveNum = 1; moveNum < list->count; ++moveNum) {
+		temp = list->moves[moveNum];
+
+		for(index = moveNum - 1; index >= 0 && list->moves[index].score < temp.score; --index) {
+			list->moves[index + 1] = list->moves[index];
+		}
+
+		list->moves[index + 1] = temp;
+	}
+}
+
+/**
+  * Function to order the losing captures of a move list after the killer moves
+  * A capture of a less valuable piece is checked by Static Exchange Evaluation. Only the move picker
+  * needs it, plain move generation (e.g. for perft) keeps the MVV-LVA scores.
+  *
+  * @param *pos Pointer to the board structure
+  * @param *list Pointer to the move list of captures
+  */
+static void DemoteLosingCaptures(const S_BOARD *pos, S_MOVELIST *list) {
+
+	int index = 0;
+	int move = NOMOVE;
+
+	for(index = 0; index < list->count; ++index) {
+		move = list->moves[index].move;
+
+		if(CAPTURED(move) != EMPTY && PieceVal[CAPTURED(move)] < PieceVal[pos->pieces[FROMSQ(move)]]
+           && StaticExchangeEval(pos, move) < 0) {
+			list->moves[index].score -= 300000;
+		}
+	}
+}
 
-			if(!SQOFFBOARD(sq - 11) && PieceCol[pos->pieces[sq - 11]] == WHITE) {
-				AddBlackPawnCapMove(pos, sq, sq-11, pos->pieces[sq - 11], list);
+/**
+  * Function to initialize a staged move picker for a node
+  *
+  * @param *picker Pointer to the move picker
+  * @param *pos Pointer to the board structure
+  * @param hashMove Move from the Hash Table, NOMOVE if there is none
+  * @param capturesOnly TRUE to pick only the captures that don't lose material (Quiescence search)
+  */
+void InitMovePicker(S_MOVEPICKER *picker, const S_BOARD *pos, const int hashMove, const int capturesOnly) {
+
+	picker->stage = PICK_HASH;
+	picker->capturesOnly = capturesOnly;
+	picker->hashMove = hashMove;
+	picker->killers[0] = pos->searchKillers[0][pos->ply];
+	picker->killers[1] = pos->searchKillers[1][pos->ply];
+	picker->captureIndex = 0;
+	picker->quietIndex = 0;
+	picker->captures->count = 0;
+	picker->quiets->count = 0;
+
+	InitCheckInfo(pos, picker->checkInfo);
+}
+
+/**
+  * Function to get the next move of a staged move picker
+  * Stages: hash move, winning captures, killer moves, losing captures, quiet moves by history.
+  * Moves are only generated when their stage is reached, so a cut-off by the hash move
+  * or a capture never pays for the quiet moves.
+  *
+  * @param *picker Pointer to the move picker
+  * @param *pos Pointer to the board structure
+  * @return The next legal move, NOMOVE when all moves are picked
+  */
+int NextMove(S_MOVEPICKER *picker, const S_BOARD *pos) {
+
+	int move = NOMOVE;
+
+	switch(picker->stage) {
+		case PICK_HASH:
+			picker->stage = PICK_GEN_CAPTURES;
+
+			// Quiescence search only plays the hash move if it's a capture
+			if(picker->hashMove != NOMOVE && (!picker->capturesOnly || (picker->hashMove & MFLAGCAP))
+               && MoveIsPseudoLegal(pos, picker->hashMove)
+               && PseudoLegalIsLegal(pos, picker->checkInfo, picker->hashMove)) {
+				return picker->hashMove;
 			}
-			if(pos->enPas != NO_SQ) {
-				if(sq - 9 == pos->enPas) {
-					AddEnPassantMove(pos, MOVE(sq,sq - 9,EMPTY,EMPTY,MFLAGEP), list);
+
+			picker->hashMove = NOMOVE;
+			/* fall through */
+
+		case PICK_GEN_CAPTURES:
+			picker->captures->count = 0;
+			AddAllCaps(pos, picker->checkInfo, picker->captures);
+			DemoteLosingCaptures(pos, picker->captures);
+			picker->stage = PICK_GOOD_CAPTURES;
+			/* fall through */
+
+		case PICK_GOOD_CAPTURES:
+			while(picker->captureIndex < picker->captures->count) {
+				PickBestMove(picker->captures, picker->captureIndex);
+
+				// Losing captures are scored below 1000000, leave them for the last stage
+				if(picker->captures->moves[picker->captureIndex].score < 1000000) {
+					break;
 				}
-				if(sq - 11 == pos->enPas) {
-					AddEnPassantMove(pos, MOVE(sq,sq - 11,EMPTY,EMPTY,MFLAGEP), list);
+
+				move = picker->captures->moves[picker->captureIndex++].move;
+
+				if(move != picker->hashMove) {
+					return move;
 				}
 			}
-		}
-	}
 
-	/* Loop for slide pieces */
-	pceIndex = LoopSlideIndex[side];
-	pce = LoopSlidePce[pceIndex++];
-	while( pce != 0) {
-		ASSERT(PieceValid(pce));
-
-		for(pceNum = 0; pceNum < pos->pceNum[pce]; ++pceNum) {
-			sq = pos->pList[pce][pceNum];
-			ASSERT(SqOnBoard(sq));
-
-			for(index = 0; index < NumDir[pce]; ++index) {
-				dir = PceDir[pce][index];
-				t_sq = sq + dir;
-
-				while(!SQOFFBOARD(t_sq)) {
-					// BLACK ^ 1 == WHITE       WHITE ^ 1 == BLACK
-					if(pos->pieces[t_sq] != EMPTY) {
-						if(PieceCol[pos->pieces[t_sq]] == (side ^ 1)) {
-							AddCaptureMove(pos, MOVE(sq, t_sq, pos->pieces[t_sq], EMPTY, 0), list);
-						}
-						break;
-					}
-					t_sq += dir;
-				}
+			if(picker->capturesOnly) {
+				picker->stage = PICK_DONE;
+				return NOMOVE;
 			}
-		}
 
-		pce = LoopSlidePce[pceIndex++];
-	}
+			picker->stage = PICK_KILLER_1;
+			/* fall through */
+
+		case PICK_KILLER_1:
+			picker->stage = PICK_KILLER_2;
+			move = picker->killers[0];
 
-	/* Loop for non slide */
-	pceIndex = LoopNonSlideIndex[side];
-	pce = LoopNonSlidePce[pceIndex++];
+			if(move != picker->hashMove && MoveIsPseudoLegal(pos, move) && PseudoLegalIsLegal(pos, picker->checkInfo, move)) {
+				return move;
+			}
+			/* fall through */
 
-	while( pce != 0) {
-		ASSERT(PieceValid(pce));
+		case PICK_KILLER_2:
+			picker->stage = PICK_BAD_CAPTURES;
+			move = picker->killers[1];
 
-		for(pceNum = 0; pceNum < pos->pceNum[pce]; ++pceNum) {
-			sq = pos->pList[pce][pceNum];
-			ASSERT(SqOnBoard(sq));
+			if(move != picker->hashMove && move != picker->killers[0]
+               && MoveIsPseudoLegal(pos, move) && PseudoLegalIsLegal(pos, picker->checkInfo, move)) {
+				return move;
+			}
+			/* fall through */
 
-			for(index = 0; index < NumDir[pce]; ++index) {
-				dir = PceDir[pce][index];
-				t_sq = sq + dir;
+		case PICK_BAD_CAPTURES:
+			while(picker->captureIndex < picker->captures->count) {
+				PickBestMove(picker->captures, picker->captureIndex);
+				move = picker->captures->moves[picker->captureIndex++].move;
 
-				if(SQOFFBOARD(t_sq)) {
-					continue;
+				if(move != picker->hashMove) {
+					return move;
 				}
+			}
+
+			picker->stage = PICK_GEN_QUIETS;
+			/* fall through */
 
-				// BLACK ^ 1 == WHITE       WHITE ^ 1 == BLACK
-				if(pos->pieces[t_sq] != EMPTY) {
-					if( PieceCol[pos->pieces[t_sq]] == (side ^ 1)) {
-						AddCaptureMove(pos, MOVE(sq, t_sq, pos->pieces[t_sq], EMPTY, 0), list);
-					}
-					continue;
+		case PICK_GEN_QUIETS:
+			picker->quiets->count = 0;
+			AddAllQuiets(pos, picker->checkInfo, picker->quiets);
+			SortMoves(picker->quiets);
+			picker->stage = PICK_QUIETS;
+			/* fall through */
+
+		case PICK_QUIETS:
+			while(picker->quietIndex < picker->quiets->count) {
+				move = picker->quiets->moves[picker->quietIndex++].move;
+
+				if(move != picker->hashMove && move != picker->killers[0] && move != picker->killers[1]) {
+					return move;
 				}
 			}
-		}
 
-		pce = LoopNonSlidePce[pceIndex++];
+			picker->stage = PICK_DONE;
+			/* fall through */
+
+		default:
+			return NOMOVE;
 	}
 }
 
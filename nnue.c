@@ -0,0 +1,606 @@
+/***********************************************************
+  * File Name: nnue.c
+  * Author: Somnath Mukherjee
+  * Description:
+  * Efficiently updatable neural network (NNUE) evaluation
+  **********************************************************/
+
+#ifndef NNUE_C
+#define NNUE_C
+
+#include "defs.h"
+#include "stdio.h"
+#include "string.h"
+
+#if defined(__AVX2__)
+#include "immintrin.h"
+#elif defined(__SSE2__)
+#include "emmintrin.h"
+#endif
+
+/**
+  * Network file format (HalfKP 256x2-32-32): version, hash of the architecture and of the feature transformer
+  * and the layers
+  */
+#define NNUE_VERSION 0x7AF32F16
+#define NNUE_HASH 0x3E5AA6EE
+#define NNUE_FT_HASH 0x5D69D7B8
+#define NNUE_NET_HASH 0x63337156
+
+/**
+  * Input and output sizes of the hidden layers, and the shift and the divisor of the integer arithmetic
+  */
+#define NNUE_L1_INPUTS (2 * NNUE_HALF_DIMS)
+#define NNUE_HIDDEN 32
+#define NNUE_WEIGHT_SHIFT 6
+#define NNUE_OUTPUT_SCALE 16
+
+/**
+  * The network's scores are in its own units, where a pawn in the endgame is 208
+  */
+#define NNUE_PAWN_VALUE 208
+
+/**
+  * Feature index of a piece for each side's perspective, before adding the square: 1 + 64 * (2 * type + enemy).
+  * Kings are not features, they select the weights
+  */
+static const int PieceFeature[NUM_PIECES][2] = {
+    { 0, 0 },
+    { 1, 65 }, { 129, 193 }, { 257, 321 }, { 385, 449 }, { 513, 577 }, { 0, 0 },
+    { 65, 1 }, { 193, 129 }, { 321, 257 }, { 449, 385 }, { 577, 513 }, { 0, 0 }
+};
+
+/**
+  * Weights of the network: the feature transformer (the accumulator) and the three layers above it
+  */
+static int16_t FtBiases[NNUE_HALF_DIMS];
+static int16_t *FtWeights = NULL;
+static int32_t L1Biases[NNUE_HIDDEN];
+static int8_t L1Weights[NNUE_HIDDEN * NNUE_L1_INPUTS];
+static int32_t L2Biases[NNUE_HIDDEN];
+static int8_t L2Weights[NNUE_HIDDEN * NNUE_HIDDEN];
+static int32_t OutBias;
+static int8_t OutWeights[NNUE_HIDDEN];
+
+/**
+  * TRUE when a network is loaded, the evaluation then uses it instead of the piece-square tables
+  */
+int UseNnue = FALSE;
+
+/**
+  * Functions to read the little endian values of the network file
+  */
+static uint32_t ReadU32(const unsigned char **ptr) {
+	const unsigned char *p = *ptr;
+	*ptr += 4;
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static int16_t ReadI16(const unsigned char **ptr) {
+	const unsigned char *p = *ptr;
+	*ptr += 2;
+	return (int16_t) ((uint16_t) p[0] | ((uint16_t) p[1] << 8));
+}
+
+/**
+  * @brief Function to load the network from a file
+  * On failure the previous network, if any, is dropped and the evaluation goes back to the piece-square tables
+  *
+  * @param *fileName Path of the network file
+  * @return TRUE if the network is loaded, FALSE otherwise
+  */
+int LoadNnue(const char *fileName) {
+
+	FILE *file = NULL;
+	unsigned char *data = NULL;
+	const unsigned char *ptr = NULL;
+	long size = 0;
+	long expected = 0;
+	uint32_t descSize = 0;
+	int index = 0;
+
+	UseNnue = FALSE;
+
+	if(FtWeights == NULL) {
+		FtWeights = (int16_t *) malloc((size_t) NNUE_INPUTS * NNUE_HALF_DIMS * sizeof(int16_t));
+
+		if(FtWeights == NULL) {
+			printf("info string NNUE weights allocation failed\n");
+			return FALSE;
+		}
+	}
+
+	// Read the whole file
+	file = fopen(fileName, "rb");
+
+	if(file == NULL) {
+		printf("info string NNUE file %s can't be opened\n", fileName);
+		return FALSE;
+	}
+
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	data = (size > 12) ? (unsigned char *) malloc((size_t) size) : NULL;
+
+	if(data == NULL || fread(data, 1, (size_t) size, file) != (size_t) size) {
+		printf("info string NNUE file %s can't be read\n", fileName);
+		free(data);
+		fclose(file);
+		return FALSE;
+	}
+
+	fclose(file);
+
+	// Header: version, architecture hash and description
+	ptr = data;
+
+	if(ReadU32(&ptr) != NNUE_VERSION || ReadU32(&ptr) != NNUE_HASH) {
+		printf("info string NNUE file %s is not a HalfKP 256x2-32-32 network\n", fileName);
+		free(data);
+		return FALSE;
+	}
+
+	descSize = ReadU32(&ptr);
+	expected = 12L + (long) descSize + 4 + NNUE_HALF_DIMS * 2 + (long) NNUE_INPUTS * NNUE_HALF_DIMS * 2
+		+ 4 + NNUE_HIDDEN * 4 + NNUE_HIDDEN * NNUE_L1_INPUTS + NNUE_HIDDEN * 4 + NNUE_HIDDEN * NNUE_HIDDEN + 4 + NNUE_HIDDEN;
+
+	if(size != expected) {
+		printf("info string NNUE file %s has the wrong size\n", fileName);
+		free(data);
+		return FALSE;
+	}
+
+	ptr += descSize;
+
+	// Feature transformer
+	if(ReadU32(&ptr) != NNUE_FT_HASH) {
+		printf("info string NNUE file %s has an unknown feature transformer\n", fileName);
+		free(data);
+		return FALSE;
+	}
+
+	for(index = 0; index < NNUE_HALF_DIMS; ++index) {
+		FtBiases[index] = ReadI16(&ptr);
+	}
+
+	for(index = 0; index < NNUE_INPUTS * NNUE_HALF_DIMS; ++index) {
+		FtWeights[index] = ReadI16(&ptr);
+	}
+
+	// Hidden layers and output, weights by output then input
+	if(ReadU32(&ptr) != NNUE_NET_HASH) {
+		printf("info string NNUE file %s has unknown layers\n", fileName);
+		free(data);
+		return FALSE;
+	}
+
+	for(index = 0; index < NNUE_HIDDEN; ++index) {
+		L1Biases[index] = (int32_t) ReadU32(&ptr);
+	}
+
+	memcpy(L1Weights, ptr, sizeof(L1Weights));
+	ptr += sizeof(L1Weights);
+
+	for(index = 0; index < NNUE_HIDDEN; ++index) {
+		L2Biases[index] = (int32_t) ReadU32(&ptr);
+	}
+
+	memcpy(L2Weights, ptr, sizeof(L2Weights));
+	ptr += sizeof(L2Weights);
+
+	OutBias = (int32_t) ReadU32(&ptr);
+	memcpy(OutWeights, ptr, sizeof(OutWeights));
+
+	free(data);
+	UseNnue = TRUE;
+
+	printf("info string NNUE file %s loaded\n", fileName);
+
+	return TRUE;
+}
+
+/**
+  * @brief Function to unload the network, the evaluation goes back to the piece-square tables
+  */
+void UnloadNnue() {
+	UseNnue = FALSE;
+}
+
+/**
+  * @brief Function to get the feature index of a piece from a side's perspective
+  * The board is rotated for Black, so each side sees its own pieces from the first rank
+  *
+  * @param perspective The side
+  * @param kingSq64 64 based square of the side's King
+  * @param pce The piece, not a King
+  * @param sq64 64 based square of the piece
+  * @return The feature index
+  */
+static int FeatureIndex(const int perspective, const int kingSq64, const int pce, const int sq64) {
+	int orient = (perspective == WHITE) ? 0 : 63;
+
+	return (kingSq64 ^ orient) * 641 + PieceFeature[pce][perspective] + (sq64 ^ orient);
+}
+
+/**
+  * @brief Function to add or subtract the weights of a feature to the accumulator of a side
+  *
+  * @param *values Accumulator of the side
+  * @param index Feature index
+  * @param add TRUE to add the feature, FALSE to subtract it
+  */
+static void UpdateFeature(int16_t *values, const int index, const int add) {
+
+	const int16_t *weights = &FtWeights[(size_t) index * NNUE_HALF_DIMS];
+	int i = 0;
+
+#if defined(__AVX2__)
+	for(i = 0; i < NNUE_HALF_DIMS; i += 16) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) &values[i]);
+		__m256i w = _mm256_loadu_si256((const __m256i *) &weights[i]);
+		v = add ? _mm256_add_epi16(v, w) : _mm256_sub_epi16(v, w);
+		_mm256_storeu_si256((__m256i *) &values[i], v);
+	}
+#elif defined(__SSE2__)
+	for(i = 0; i < NNUE_HALF_DIMS; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *) &values[i]);
+		__m128i w = _mm_loadu_si128((const __m128i *) &weights[i]);
+		v = add ? _mm_add_epi16(v, w) : _mm_sub_epi16(v, w);
+		_mm_storeu_si128((__m128i *) &values[i], v);
+	}
+#else
+	for(i = 0; i < NNUE_HALF_DIMS; ++i) {
+		values[i] = (int16_t) (add ? values[i] + weights[i] : values[i] - weights[i]);
+	}
+#endif
+}
+
+/**
+  * @brief Function to compute the accumulator of a side from scratch: the biases plus the weights of every piece
+  *
+  * @param *pos Pointer to the board structure
+  * @param *acc Accumulator of the position
+  * @param perspective The side
+  */
+static void RefreshAccumulator(const S_BOARD *pos, S_ACCUMULATOR *acc, const int perspective) {
+
+	int kingSq64 = SQ64(pos->kingSq[perspective]);
+	int pce = EMPTY;
+	U64 bb = 0ULL;
+
+	memcpy(acc->values[perspective], FtBiases, sizeof(FtBiases));
+
+	for(pce = wP; pce <= bQ; ++pce) {
+		if(pce == wK) {
+			continue;
+		}
+
+		bb = pos->pieceBB[pce];
+
+		while(bb) {
+			UpdateFeature(acc->values[perspective], FeatureIndex(perspective, kingSq64, pce, POP(&bb)), TRUE);
+		}
+	}
+
+	acc->computed[perspective] = TRUE;
+}
+
+/**
+  * @brief Function to bring the accumulator of a side up to date
+  * Walks back the positions of the game to the last one with the accumulator computed, then adds and subtracts
+  * the pieces changed since. Computes it from scratch instead if the side's King moved on the way, if the
+  * changes are unknown or if there are more of them than pieces on the board.
+  *
+  * @param *pos Pointer to the board structure
+  * @param perspective The side
+  */
+static void UpdateAccumulator(const S_BOARD *pos, const int perspective) {
+
+	S_ACCUMULATOR *acc = &pos->Accumulators[pos->hisPly];
+	S_ACCUMULATOR *entry = NULL;
+	int kingSq64 = SQ64(pos->kingSq[perspective]);
+	int king = SIDE_PCE(wK, perspective);
+	int budget = CNT(pos->occupancy[BOTH]);
+	int ply = pos->hisPly;
+	int index = 0;
+
+	if(acc->computed[perspective]) {
+		return;
+	}
+
+	// Find the last position with the accumulator computed
+	while(TRUE) {
+		entry = &pos->Accumulators[ply];
+		budget -= entry->dirtyNum;
+
+		if(entry->dirtyNum < 0 || budget < 0 || ply == 0) {
+			RefreshAccumulator(pos, acc, perspective);
+			return;
+		}
+
+		for(index = 0; index < entry->dirtyNum; ++index) {
+			if(entry->dirtyPce[index] == king) {
+				RefreshAccumulator(pos, acc, perspective);
+				return;
+			}
+		}
+
+		ply--;
+
+		if(pos->Accumulators[ply].computed[perspective]) {
+			break;
+		}
+	}
+
+	// Apply the changes of the positions after it; the other side's King isn't a feature
+	memcpy(acc->values[perspective], pos->Accumulators[ply].values[perspective], sizeof(acc->values[perspective]));
+
+	for(ply = ply + 1; ply <= pos->hisPly; ++ply) {
+		entry = &pos->Accumulators[ply];
+
+		for(index = 0; index < entry->dirtyNum; ++index) {
+			if(PieceKing[entry->dirtyPce[index]]) {
+				continue;
+			}
+
+			if(entry->dirtyFrom[index] != NO_SQ) {
+				UpdateFeature(acc->values[perspective],
+                              FeatureIndex(perspective, kingSq64, entry->dirtyPce[index], entry->dirtyFrom[index]), FALSE);
+			}
+
+			if(entry->dirtyTo[index] != NO_SQ) {
+				UpdateFeature(acc->values[perspective],
+                              FeatureIndex(perspective, kingSq64, entry->dirtyPce[index], entry->dirtyTo[index]), TRUE);
+			}
+		}
+	}
+
+	acc->computed[perspective] = TRUE;
+}
+
+/**
+  * @brief Function to record a changed piece in the accumulator of a position
+  *
+  * @param *acc Accumulator of the position
+  * @param pce The piece
+  * @param from 120 based square the piece leaves, NO_SQ if it's added
+  * @param to 120 based square the piece goes to, NO_SQ if it's removed
+  */
+static void AddDirtyPiece(S_ACCUMULATOR *acc, const int pce, const int from, const int to) {
+
+	ASSERT(acc->dirtyNum < 3);
+
+	acc->dirtyPce[acc->dirtyNum] = pce;
+	acc->dirtyFrom[acc->dirtyNum] = (from == NO_SQ) ? NO_SQ : SQ64(from);
+	acc->dirtyTo[acc->dirtyNum] = (to == NO_SQ) ? NO_SQ : SQ64(to);
+	acc->dirtyNum++;
+}
+
+/**
+  * @brief Function to record the pieces a move changes, for the accumulator of the position after it
+  * Called by MakeMove before the move is made. The accumulator itself is only updated when the position is evaluated.
+  *
+  * @param *pos Pointer to the board structure
+  * @param move Move about to be made
+  */
+void NnueMakeMove(S_BOARD *pos, const int move) {
+
+	S_ACCUMULATOR *acc = &pos->Accumulators[pos->hisPly + 1];
+	int from = FROMSQ(move);
+	int to = TOSQ(move);
+	int pce = pos->pieces[from];
+	int captured = CAPTURED(move);
+
+	acc->computed[WHITE] = acc->computed[BLACK] = FALSE;
+	acc->dirtyNum = 0;
+
+	// The moving piece, or the pawn becoming the promoted piece
+	if(PROMOTED(move) != EMPTY) {
+		AddDirtyPiece(acc, pce, from, NO_SQ);
+		AddDirtyPiece(acc, PROMOTED(move), NO_SQ, to);
+	} else {
+		AddDirtyPiece(acc, pce, from, to);
+	}
+
+	// The captured piece, below or above the to square for an en passant capture
+	if(move & MFLAGEP) {
+		AddDirtyPiece(acc, pos->pieces[(pos->side == WHITE) ? to - 10 : to + 10], (pos->side == WHITE) ? to - 10 : to + 10, NO_SQ);
+	} else if(captured != EMPTY) {
+		AddDirtyPiece(acc, captured, to, NO_SQ);
+	}
+
+	// The rook of a castling move
+	if(move & MFLAGCA) {
+		switch(to) {
+			case C1: AddDirtyPiece(acc, wR, A1, D1); break;
+			case C8: AddDirtyPiece(acc, bR, A8, D8); break;
+			case G1: AddDirtyPiece(acc, wR, H1, F1); break;
+			case G8: AddDirtyPiece(acc, bR, H8, F8); break;
+			default: ASSERT(FALSE); break;
+		}
+	}
+}
+
+/**
+  * @brief Function to record a null move: the pieces don't change
+  *
+  * @param *pos Pointer to the board structure
+  */
+void NnueMakeNullMove(S_BOARD *pos) {
+
+	S_ACCUMULATOR *acc = &pos->Accumulators[pos->hisPly + 1];
+
+	acc->computed[WHITE] = acc->computed[BLACK] = FALSE;
+	acc->dirtyNum = 0;
+}
+
+/**
+  * @brief Function to mark the accumulator of the current position as unknown, e.g. after setting up a position
+  * or when a search thread starts from a copy of the board. It's computed from scratch when needed.
+  *
+  * @param *pos Pointer to the board structure
+  */
+void NnueReset(S_BOARD *pos) {
+
+	S_ACCUMULATOR *acc = &pos->Accumulators[pos->hisPly];
+
+	acc->computed[WHITE] = acc->computed[BLACK] = FALSE;
+	acc->dirtyNum = -1;
+}
+
+/**
+  * @brief Function to clamp the accumulators of both sides to 0..127, side to move first
+  *
+  * @param *acc Accumulator of the position
+  * @param side Side to move
+  * @param *output Inputs of the first hidden layer
+  */
+static void TransformFeatures(const S_ACCUMULATOR *acc, const int side, uint8_t *output) {
+
+	int perspective = 0;
+	int i = 0;
+
+	for(perspective = 0; perspective < 2; ++perspective) {
+		const int16_t *values = acc->values[perspective == 0 ? side : side ^ 1];
+		uint8_t *out = &output[perspective * NNUE_HALF_DIMS];
+
+#if defined(__AVX2__)
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i max = _mm256_set1_epi16(127);
+
+		for(i = 0; i < NNUE_HALF_DIMS; i += 32) {
+			__m256i v0 = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i *) &values[i]), zero), max);
+			__m256i v1 = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i *) &values[i + 16]), zero), max);
+			// Packing works within each 128 bit lane, put the quarters back in order
+			_mm256_storeu_si256((__m256i *) &out[i], _mm256_permute4x64_epi64(_mm256_packus_epi16(v0, v1), 0xD8));
+		}
+#elif defined(__SSE2__)
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i max = _mm_set1_epi16(127);
+
+		for(i = 0; i < NNUE_HALF_DIMS; i += 16) {
+			__m128i v0 = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i *) &values[i]), zero), max);
+			__m128i v1 = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i *) &values[i + 8]), zero), max);
+			_mm_storeu_si128((__m128i *) &out[i], _mm_packus_epi16(v0, v1));
+		}
+#else
+		for(i = 0; i < NNUE_HALF_DIMS; ++i) {
+			out[i] = (uint8_t) MIN(MAX(values[i], 0), 127);
+		}
+#endif
+	}
+}
+
+/**
+  * @brief Function to compute the dot product of 8 bit inputs and weights
+  *
+  * @param *input Inputs, 0..127
+  * @param *weights Weights
+  * @param size Number of inputs, a multiple of 32
+  * @return The dot product
+  */
+static int32_t DotProduct(const uint8_t *input, const int8_t *weights, const int size) {
+
+	int i = 0;
+
+#if defined(__AVX2__)
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256i sum = _mm256_setzero_si256();
+	__m128i sum128;
+
+	for(i = 0; i < size; i += 32) {
+		// Multiply and add pairs to 16 bits, can't overflow with inputs up to 127, then pairs to 32 bits
+		__m256i product = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i *) &input[i]),
+                                               _mm256_loadu_si256((const __m256i *) &weights[i]));
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(product, ones));
+	}
+
+	sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4E));
+	sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xB1));
+
+	return _mm_cvtsi128_si32(sum128);
+#elif defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = _mm_setzero_si128();
+
+	for(i = 0; i < size; i += 16) {
+		__m128i in = _mm_loadu_si128((const __m128i *) &input[i]);
+		__m128i w = _mm_loadu_si128((const __m128i *) &weights[i]);
+		// Widen to 16 bits: the inputs with zeros, the weights with their sign
+		__m128i inLo = _mm_unpacklo_epi8(in, zero);
+		__m128i inHi = _mm_unpackhi_epi8(in, zero);
+		__m128i wLo = _mm_srai_epi16(_mm_unpacklo_epi8(w, w), 8);
+		__m128i wHi = _mm_srai_epi16(_mm_unpackhi_epi8(w, w), 8);
+
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(inLo, wLo));
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(inHi, wHi));
+	}
+
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+
+	return _mm_cvtsi128_si32(sum);
+#else
+	int32_t sum = 0;
+
+	for(i = 0; i < size; ++i) {
+		sum += (int32_t) input[i] * weights[i];
+	}
+
+	return sum;
+#endif
+}
+
+/**
+  * @brief Function to compute a hidden layer: weights times inputs plus biases, clipped to 0..127
+  *
+  * @param *input Inputs, 0..127
+  * @param inputSize Number of inputs, a multiple of 32
+  * @param *biases Biases
+  * @param *weights Weights, by output then input
+  * @param *output NNUE_HIDDEN outputs
+  */
+static void HiddenLayer(const uint8_t *input, const int inputSize, const int32_t *biases, const int8_t *weights,
+                        uint8_t *output) {
+
+	int index = 0;
+	int32_t sum = 0;
+
+	for(index = 0; index < NNUE_HIDDEN; ++index) {
+		sum = (biases[index] + DotProduct(input, &weights[index * inputSize], inputSize)) >> NNUE_WEIGHT_SHIFT;
+		output[index] = (uint8_t) MIN(MAX(sum, 0), 127);
+	}
+}
+
+/**
+  * @brief Function to evaluate a position with the network
+  *
+  * @param *pos Pointer to the board structure, with its accumulators
+  * @return Score of the position for the side to move, in centipawns
+  */
+int NnueEvaluate(const S_BOARD *pos) {
+
+	ASSERT(UseNnue);
+	ASSERT(pos->Accumulators != NULL);
+
+	uint8_t input[NNUE_L1_INPUTS];
+	uint8_t hidden1[NNUE_HIDDEN];
+	uint8_t hidden2[NNUE_HIDDEN];
+	int32_t output = 0;
+
+	UpdateAccumulator(pos, WHITE);
+	UpdateAccumulator(pos, BLACK);
+
+	TransformFeatures(&pos->Accumulators[pos->hisPly], pos->side, input);
+	HiddenLayer(input, NNUE_L1_INPUTS, L1Biases, L1Weights, hidden1);
+	HiddenLayer(hidden1, NNUE_HIDDEN, L2Biases, L2Weights, hidden2);
+
+	output = OutBias + DotProduct(hidden2, OutWeights, NNUE_HIDDEN);
+
+	return output / NNUE_OUTPUT_SCALE * 100 / NNUE_PAWN_VALUE;
+}
+
+#endif // NNUE_C
@@ -10,101 +10,343 @@
 
 #include "defs.h"
 #include "stdio.h"
+#include "string.h"
 
 /**
-  * Leaf Nodes count
+  * The perft Hash Table, shared by all perft threads. Allocated on the first perft
   */
-long leafNodes;
+static S_PERFTENTRY *PerftTable = NULL;
+static U64 PerftEntries = 0;
 
 /**
-  * Function to run perft testing
+  * Work shared by the perft threads: the root moves, the index of the next one to count
+  * and the leaf node count of each
+  */
+static pthread_mutex_t PerftLock = PTHREAD_MUTEX_INITIALIZER;
+static S_MOVELIST PerftMoves[1];
+static U64 PerftCounts[MAXPOSITIONMOVES];
+static int PerftNextMove = 0;
+static int PerftDepth = 0;
+
+/**
+  * Function to allocate the perft Hash Table
+  * If the memory is not available, perft runs without it
+  */
+static void InitPerftTable() {
+
+	U64 size = (U64) PERFT_HASH_MB * 0x100000;
+
+	if(PerftTable != NULL) {
+		return;
+	}
+
+	while(size >= 0x100000) {
+		PerftTable = (S_PERFTENTRY *) calloc((size_t) (size / sizeof(S_PERFTENTRY)), sizeof(S_PERFTENTRY));
+
+		if(PerftTable != NULL) {
+			PerftEntries = size / sizeof(S_PERFTENTRY);
+			return;
+		}
+
+		size /= 2;
+	}
+}
+
+/**
+  * Function to get the perft Hash Table entry of a position and depth
+  * The depth is mixed into the index so the counts of one position at several depths don't collide
   *
-    * @param depth Depth to test
+  * @param posKey Position key
+  * @param depth Depth
+  * @return Pointer to the entry
+  */
+static S_PERFTENTRY *GetPerftEntry(const U64 posKey, const int depth) {
+	U64 key = posKey ^ ((U64) depth * 0x9E3779B97F4A7C15ULL);
+
+	return &PerftTable[((key >> 32) * PerftEntries) >> 32];
+}
+
+/**
+  * Function to count the leaf nodes of a position (perft)
+  * Moves are bulk counted at the last ply and the counts of the subtrees are cached in the
+  * perft Hash Table. Reentrant: it only touches the board passed in and the lock-free table.
+  *
+  * @param depth Depth to test
   * @param *pos Board position
+  * @return Number of leaf nodes
   */
-void Perft(int depth, S_BOARD *pos) {
+U64 Perft(const int depth, S_BOARD *pos) {
 
     ASSERT(CheckBoard(pos));
 
-    // If depth is zero terminate recursion after incrementing leaf nodes count
+    // If depth is zero the position is the leaf node
 	if(depth == 0) {
-        leafNodes++;
-        return;
+        return 1;
     }
 
     S_MOVELIST list[1];
-    // Generate all the moves for the current position
+    // Generate all the legal moves for the current position
     GenerateAllMoves(pos,list);
 
+    // At the last ply every legal move is a leaf node, no need to make them
+    if(depth == 1) {
+        return (U64) list->count;
+    }
+
+    S_PERFTENTRY *entry = NULL;
+    U64 data = 0ULL;
+    U64 nodes = 0ULL;
+
+    // Look up the count of the subtree; read each word once, another thread may write the entry
+    if(PerftTable != NULL) {
+        entry = GetPerftEntry(pos->posKey, depth);
+        data = entry->data;
+
+        if((entry->smpKey ^ data) == pos->posKey && (int) (data & 0xFF) == depth) {
+            return data >> 8;
+        }
+    }
+
     int MoveNum = 0;
     // Loop through all the moves in this position
 	for(MoveNum = 0; MoveNum < list->count; ++MoveNum) {
-        // Ignore illegal moves
-        if (!MakeMove(pos,list->moves[MoveNum].move))  {
-            continue;
-        }
+        MakeMove(pos,list->moves[MoveNum].move);
 
         // Call recursively again with reduced depth
-        Perft(depth - 1, pos);
+        nodes += Perft(depth - 1, pos);
         // take the move back
         TakeMove(pos);
     }
 
-    // Return when moves lits is exhausted
-    return;
+    // Store the count of the subtree, always replacing
+    if(entry != NULL) {
+        data = (nodes << 8) | (U64) depth;
+        entry->data = data;
+        entry->smpKey = pos->posKey ^ data;
+    }
+
+    return nodes;
 }
 
+/**
+  * Function for a perft thread: counts the root moves one at a time until none are left
+  *
+  * @param *arg Pointer to the S_PERFTTHREAD of the thread
+  */
+static void *PerftWorker(void *arg) {
+
+	S_PERFTTHREAD *thread = (S_PERFTTHREAD *) arg;
+	int moveNum = 0;
+
+	while(TRUE) {
+		// Take the next root move
+		pthread_mutex_lock(&PerftLock);
+		moveNum = PerftNextMove++;
+		pthread_mutex_unlock(&PerftLock);
+
+		if(moveNum >= PerftMoves->count) {
+			break;
+		}
+
+		MakeMove(thread->pos, PerftMoves->moves[moveNum].move);
+		PerftCounts[moveNum] = Perft(PerftDepth - 1, thread->pos);
+		TakeMove(thread->pos);
+	}
+
+	return NULL;
+}
+
+/**
+  * Function to count the leaf nodes of a position with several threads
+  * The root moves are split across the threads, each taking the next move when it's done.
+  * The threads share the subtree counts through the perft Hash Table.
+  *
+  * @param depth Depth to test, at least 1
+  * @param *pos Board position
+  * @param threadNum Number of threads
+  * @param divide If TRUE, print the leaf node count of each root move
+  * @return Number of leaf nodes
+  */
+U64 PerftRoot(const int depth, S_BOARD *pos, int threadNum, const int divide) {
+
+    ASSERT(CheckBoard(pos));
+    ASSERT(depth >= 1);
+
+	S_PERFTTHREAD *threads = NULL;
+	U64 nodes = 0ULL;
+	int index = 0;
+	int started = 0;
+
+	InitPerftTable();
+
+	GenerateAllMoves(pos, PerftMoves);
+	memset(PerftCounts, 0, sizeof(PerftCounts));
+	PerftNextMove = 0;
+	PerftDepth = depth;
+
+	threadNum = MAX(1, MIN(threadNum, MIN(MAX_THREADS, PerftMoves->count)));
+	threads = (S_PERFTTHREAD *) malloc(threadNum * sizeof(S_PERFTTHREAD));
+
+	if(threads == NULL) {
+		printf("Perft threads allocation failed\n");
+		return 0ULL;
+	}
+
+	// Each thread counts on its own copy of the board
+	for(index = 0; index < threadNum; ++index) {
+		threads[index].pos[0] = *pos;
+		threads[index].pos->Accumulators = NULL;
+
+		if(pthread_create(&threads[index].handle, NULL, PerftWorker, &threads[index]) != 0) {
+			break;
+		}
+	}
+
+	started = index;
+
+	// If no thread could be started, count on the caller's thread
+	if(started == 0) {
+		threads[0].pos[0] = *pos;
+		threads[0].pos->Accumulators = NULL;
+		PerftWorker(&threads[0]);
+	}
+
+	for(index = 0; index < started; ++index) {
+		pthread_join(threads[index].handle, NULL);
+	}
+
+	free(threads);
+
+	for(index = 0; index < PerftMoves->count; ++index) {
+		nodes += PerftCounts[index];
+
+		if(divide) {
+			printf("move %d : %s : %llu\n", index + 1, PrMove(PerftMoves->moves[index].move), PerftCounts[index]);
+		}
+	}
+
+	return nodes;
+}
 
 /**
   * Function to drive perft testing with depth details
   *
   * @param depth Depth to test
   * @param *pos Board position
+  * @param threadNum Number of threads
   */
-void PerftTest(int depth, S_BOARD *pos) {
+void PerftTest(const int depth, S_BOARD *pos, const int threadNum) {
 
     ASSERT(CheckBoard(pos));
 
 	PrintBoard(pos);
 	printf("\nStarting Test To Depth:%d\n",depth);
-	// Reset leaf nodes count
-	leafNodes = 0;
 
     // Get start time
-	int startTime = GetTimeMs();
+	U64 startTime = GetTimeMs();
 
-    S_MOVELIST list[1];
-    // Generate all moves
-    GenerateAllMoves(pos,list);
+	U64 nodes = (depth > 0) ? PerftRoot(depth, pos, threadNum, TRUE) : 1ULL;
 
-    int move;
-    int MoveNum = 0;
+    U64 endTime = GetTimeMs();
+	printf("\nTest Complete : %llu nodes visited in %dms\n", nodes, (int) (endTime - startTime));
 
-    // Loop through all the moves in this position
-	for(MoveNum = 0; MoveNum < list->count; ++MoveNum) {
-        // Get the move
-        move = list->moves[MoveNum].move;
+    return;
+}
 
-        // Ignore illegal moves
-        if ( !MakeMove(pos,move))  {
-            continue;
-        }
+/**
+  * Function to run a perft suite from an EPD file
+  * Each line holds a FEN and its expected counts: "<fen> ;D1 20 ;D2 400 ...". Lines are read one at a time
+  * and every depth up to maxDepth is checked. Prints the result, nodes, time and NPS of each position.
+  *
+  * @param *fileName Path of the EPD file
+  * @param maxDepth Deepest depth to check
+  * @param *pos Board position, overwritten by the positions of the suite
+  * @param threadNum Number of threads
+  * @return TRUE if all counts match, FALSE on a mismatch or if the file can't be read
+  */
+int PerftSuite(const char *fileName, const int maxDepth, S_BOARD *pos, const int threadNum) {
 
-        // Initialize cumulative leaf nodes count
-        long cumnodes = leafNodes;
-        // Run perft with reduced depth
-        Perft(depth - 1, pos);
-        // Take back the move
-        TakeMove(pos);
-        // Get the current leaf nodes count
-        long oldnodes = leafNodes - cumnodes;
-        printf("move %d : %s (%s) : %ld\n", MoveNum+1, PrMove(move), PrAlgMove(move, pos), oldnodes);
-    }
+	FILE *file = fopen(fileName, "r");
+	char line[1024];
+	char *ptr = NULL;
+	int depth = 0;
+	int length = 0;
+	int posNum = 0;
+	int failed = 0;
+	int passed = TRUE;
+	U64 startTime = 0ULL;
+	int time = 0;
+	int totalTime = 0;
+	U64 expected = 0ULL;
+	U64 count = 0ULL;
+	U64 nodes = 0ULL;
+	U64 totalNodes = 0ULL;
 
-    int endTime = GetTimeMs();
-	printf("\nTest Complete : %ld nodes visited in %dms\n", leafNodes, endTime - startTime);
+	if(file == NULL) {
+		printf("Perft suite %s can't be opened\n", fileName);
+		return FALSE;
+	}
 
-    return;
+	while(fgets(line, sizeof(line), file) != NULL) {
+		// The FEN ends at the first depth
+		ptr = strchr(line, ';');
+
+		if(ptr == NULL) {
+			continue;
+		}
+
+		*ptr++ = '\0';
+		posNum++;
+
+		// Trim the spaces after the FEN
+		for(length = (int) strlen(line); length > 0 && line[length - 1] == ' '; --length) {
+			line[length - 1] = '\0';
+		}
+
+		if(ParseFen(line, pos) != 0) {
+			printf("#%d FAIL invalid FEN %s\n", posNum, line);
+			failed++;
+			continue;
+		}
+
+		passed = TRUE;
+		nodes = 0ULL;
+		startTime = GetTimeMs();
+
+		// Check the depths in turn, ";D<depth> <count>"
+		while(ptr != NULL && sscanf(ptr, "D%d %llu", &depth, &expected) == 2) {
+			if(depth >= 1 && depth <= maxDepth) {
+				count = PerftRoot(depth, pos, threadNum, FALSE);
+				nodes += count;
+
+				if(count != expected) {
+					printf("#%d depth %d: %llu nodes, expected %llu\n", posNum, depth, count, expected);
+					passed = FALSE;
+				}
+			}
+
+			ptr = strchr(ptr, ';');
+			ptr = (ptr != NULL) ? ptr + 1 : NULL;
+		}
+
+		time = (int) (GetTimeMs() - startTime);
+		totalTime += time;
+		totalNodes += nodes;
+
+		if(!passed) {
+			failed++;
+		}
+
+		printf("#%d %s nodes %llu time %d nps %llu %s\n", posNum, passed ? "pass" : "FAIL", nodes, time,
+               nodes * 1000 / (U64) MAX(time, 1), line);
+	}
+
+	fclose(file);
+
+	printf("\nPerft suite: %d positions, %d failed, nodes %llu time %d nps %llu\n", posNum, failed, totalNodes,
+           totalTime, totalNodes * 1000 / (U64) MAX(totalTime, 1));
+
+	return (failed == 0 && posNum > 0) ? TRUE : FALSE;
 }
 
 #endif // PERFT_C
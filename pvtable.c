@@ -2,7 +2,7 @@
   * File Name: pvtable.c
   * Author: Somnath Mukherjee
   * Description:
-  * Principal Variation table
+  * Hash table (Transposition table) and Principal Variation
   **********************************************************/
 
 #ifndef PVTABLE_C
@@ -10,98 +10,384 @@
 
 #include "defs.h"
 #include "stdio.h"
+#include "string.h"
 
 /**
-  * Size of the Principal Variation table, 2 MB
+  * The Hash Table, shared by all search threads
   */
-const int PvSize = 0x100000 * 2;
+S_HASHTABLE HashTable[1];
+
+#ifndef WIN32
+#include "sys/mman.h"
+#endif
+
+/**
+  * Size of a huge page, 2 MB. Large tables are aligned to it so they can be backed by huge pages
+  */
+#define HUGE_PAGE_SIZE (0x100000 * 2)
+
+/* HASH ENTRY DATA */
+/*
+
+0000 0000 0000 0000 0000 0000 0000 0000 0000 0001 1111 1111 1111 1111 1111 1111 -> Move 0x1FFFFFF
+0000 0000 0000 0000 0000 0001 1111 1111 1111 1110 0000 0000 0000 0000 0000 0000 -> Score + INFINITE >> 25, 0xFFFF
+0000 0000 0000 0001 1111 1110 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 -> Depth >> 41, 0xFF
+0000 0000 0000 0110 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 -> Flags >> 49, 0x3
+0000 0111 1111 1000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 -> Age >> 51, 0xFF
+
+*/
+
+#define HASH_MOVE(d) ((int) ((d) & 0x1FFFFFF))
+#define HASH_SCORE(d) ((int) (((d) >> 25) & 0xFFFF) - INFINITE)
+#define HASH_DEPTH(d) ((int) (((d) >> 41) & 0xFF))
+#define HASH_FLAGS(d) ((int) (((d) >> 49) & 0x3))
+#define HASH_AGE(d) ((int) (((d) >> 51) & 0xFF))
+
+#define HASH_DATA(m,s,d,f,a) ((U64) (m) | ((U64) ((s) + INFINITE) << 25) | ((U64) (d) << 41) | ((U64) (f) << 49) | ((U64) ((a) & 0xFF) << 51))
+
+/**
+  * Function to get the bucket of a position key
+  * Multiply-shift maps the upper 32 bits of the key onto 0 .. numBuckets - 1 without a 64 bit modulo
+  *
+  * @param *table Hash Table
+  * @param posKey Position key
+  * @return Pointer to the bucket
+  */
+static S_HASHBUCKET *GetBucket(const S_HASHTABLE *table, const U64 posKey) {
+    U64 index = ((posKey >> 32) * table->numBuckets) >> 32;
+
+    ASSERT(index < table->numBuckets);
+
+    return &table->pTable[index];
+}
 
 /**
-  * Function to clear the Principal Variation table
+  * Function to find the entry of a position in its bucket
+  *
+  * Entries are written by all search threads without locks. An entry stores the position key
+  * XORed with its data, so an entry torn by two threads writing at once fails the check below
+  * and is treated as a miss.
   *
-  * @param *table Principal Variation Table
+  * @param *table Hash Table
+  * @param posKey Position key
+  * @param *data Set to the data of the entry
+  * @return TRUE if the position is stored, FALSE otherwise
   */
-void ClearPvTable(S_PVTABLE *table) {
+static int FindHashEntry(const S_HASHTABLE *table, const U64 posKey, U64 *data) {
+    S_HASHBUCKET *bucket = GetBucket(table, posKey);
+    U64 smpKey = 0ULL;
+    int index = 0;
+
+    for(index = 0; index < HASH_BUCKET_SIZE; ++index) {
+        // Read each word once, the entry may be written at the same time
+        *data = bucket->entries[index].data;
+        smpKey = bucket->entries[index].smpKey;
 
-  S_PVENTRY *pvEntry;
+        if((smpKey ^ *data) == posKey && HASH_FLAGS(*data) != HFNONE) {
+            return TRUE;
+        }
+    }
 
-  for (pvEntry = table->pTable; pvEntry < table->pTable + table->numEntries; pvEntry++) {
-    // Clear the position key
-    pvEntry->posKey = 0ULL;
-    // Clear the move
-    pvEntry->move = NOMOVE;
-  }
+    return FALSE;
 }
 
 /**
-  * Function to initialize the Principal Variation table
+  * Function to clear the Hash table
   *
-  * @param *table Principal Variation Table
+  * @param *table Hash Table
   */
-void InitPvTable(S_PVTABLE *table) {
-    // Initialize number of entries as total PvTable size / size of one entry
-    table->numEntries = PvSize / sizeof(S_PVENTRY);
-    // Reduce 2 for indexing purpose, for safety
-    table->numEntries -= 2;
+void ClearHashTable(S_HASHTABLE *table) {
+
+  // Clear the buckets; a zero entry has no move and the flag HFNONE
+  memset(table->pTable, 0, (size_t) table->numBuckets * sizeof(S_HASHBUCKET));
+
+  // Reset the age
+  table->age = 0;
+}
+
+/**
+  * Function to allocate the buckets of the Hash table
+  * Tables of at least a huge page are aligned to the huge page size and, where transparent huge pages
+  * are available, advised to be backed by them. This saves most of the TLB misses of a large table.
+  *
+  * @param *table Hash Table
+  * @param size Size of the buckets in bytes
+  * @return TRUE if the memory was allocated, FALSE otherwise
+  */
+static int AllocHashTable(S_HASHTABLE *table, const size_t size) {
+#ifndef WIN32
+    if(size >= HUGE_PAGE_SIZE) {
+        if(posix_memalign(&table->mem, HUGE_PAGE_SIZE, size) != 0) {
+            table->mem = NULL;
+            return FALSE;
+        }
+
+#ifdef MADV_HUGEPAGE
+        madvise(table->mem, size, MADV_HUGEPAGE);
+#endif
+
+        table->pTable = (S_HASHBUCKET *) table->mem;
+        return TRUE;
+    }
+#endif
+
+    // Allocate memory, with room to align the buckets to the cache line
+    table->mem = malloc(size + 63);
+    if(table->mem == NULL) {
+        return FALSE;
+    }
+
+    table->pTable = (S_HASHBUCKET *) (((size_t) table->mem + 63) & ~((size_t) 63));
+    return TRUE;
+}
+
+/**
+  * Function to initialize (or resize) the Hash table
+  * If the memory is not available, the size is halved until it is
+  *
+  * @param *table Hash Table
+  * @param MB Size of the table in MB
+  */
+void InitHashTable(S_HASHTABLE *table, const int MB) {
+    ASSERT(sizeof(S_HASHENTRY) == 16);
+    ASSERT(sizeof(S_HASHBUCKET) == 64);
+    ASSERT(MB >= HASH_MIN_MB && MB <= HASH_MAX_MB);
+
+    U64 size = (U64) MB * 0x100000;
+
     // Release the memory
-    free(table->pTable);
-    // Allocate memory
-    table->pTable = (S_PVENTRY *) malloc(table->numEntries * sizeof(S_PVENTRY));
+    free(table->mem);
+    table->mem = NULL;
+
+    while(AllocHashTable(table, (size_t) size) == FALSE) {
+        if(size <= 0x100000) {
+            printf("Hash Table allocation failed\n");
+            exit(1);
+        }
+
+        size /= 2;
+    }
+
+    // Initialize number of buckets as total HashTable size / size of one bucket
+    table->numBuckets = (unsigned int) (size / sizeof(S_HASHBUCKET));
     // Clear the table
-    ClearPvTable(table);
+    ClearHashTable(table);
+
+    printf("\nHashTable initialization complete with %u buckets of %d entries (%llu MB)\n",
+           table->numBuckets, HASH_BUCKET_SIZE, size / 0x100000);
+
+}
+
+/**
+  * Function to get how full the Hash table is, in permill
+  * Counts the entries written by the current search in the first 1000 entries
+  *
+  * @param *table Hash Table
+  * @return Permill of the entries used by the current search
+  */
+int HashFull(const S_HASHTABLE *table) {
+    int bucket = 0;
+    int index = 0;
+    int used = 0;
+    int numBuckets = 1000 / HASH_BUCKET_SIZE;
+    U64 data = 0ULL;
+
+    if(table->numBuckets < (unsigned int) numBuckets) {
+        numBuckets = table->numBuckets;
+    }
 
-    printf("\nPvTable initialization complete with %d entries\n", table->numEntries);
+    for(bucket = 0; bucket < numBuckets; ++bucket) {
+        for(index = 0; index < HASH_BUCKET_SIZE; ++index) {
+            data = table->pTable[bucket].entries[index].data;
+            if(HASH_FLAGS(data) != HFNONE && HASH_AGE(data) == (table->age & 0xFF)) {
+                used++;
+            }
+        }
+    }
 
+    return used * 1000 / (numBuckets * HASH_BUCKET_SIZE);
 }
 
 /**
-  * Function to store a move in Principal Variation table
+  * Function to store a search result in the Hash table
+  *
+  * Mate scores are stored relative to the current position (distance to mate from here),
+  * and converted back to distance from the root when probed.
+  *
+  * Replacement: an existing entry of the same position is overwritten unless it holds a deeper
+  * result of the current search. Otherwise the entry of the bucket with the lowest depth, less
+  * 8 plies for every search it is older, is replaced. Empty entries are taken first.
+  *
+  * @param *pos Board position
+  * @param move Best move found
+  * @param score Score of the search
+  * @param flags Bound type of the score (HFALPHA, HFBETA or HFEXACT)
+  * @param depth Depth of the search
+  */
+void StoreHashEntry(S_BOARD *pos, const int move, int score, const int flags, const int depth) {
+	S_HASHTABLE *table = pos->HashTable;
+	S_HASHBUCKET *bucket = GetBucket(table, pos->posKey);
+	S_HASHENTRY *entry = NULL;
+	U64 data = 0ULL;
+	U64 oldData = 0ULL;
+	int index = 0;
+	int value = 0;
+	int worstValue = INFINITE;
+	int newMove = move;
+	int samePosition = FALSE;
+
+	ASSERT(depth >= 0 && depth <= 0xFF);
+	ASSERT(flags >= HFALPHA && flags <= HFEXACT);
+	ASSERT(score >= -INFINITE && score <= INFINITE);
+	ASSERT(pos->ply >= 0 && pos->ply < MAXDEPTH);
+
+	for(index = 0; index < HASH_BUCKET_SIZE; ++index) {
+		data = bucket->entries[index].data;
+
+	    // Same position
+		if((bucket->entries[index].smpKey ^ data) == pos->posKey && HASH_FLAGS(data) != HFNONE) {
+			entry = &bucket->entries[index];
+			oldData = data;
+			samePosition = TRUE;
+			break;
+		}
+
+        // Empty entries first, then shallow and old ones
+		if(HASH_FLAGS(data) == HFNONE) {
+			value = -INFINITE;
+		} else {
+			value = HASH_DEPTH(data) - 8 * ((table->age - HASH_AGE(data)) & 0xFF);
+		}
+
+		if(value < worstValue) {
+			worstValue = value;
+			entry = &bucket->entries[index];
+			oldData = data;
+		}
+	}
+
+	ASSERT(entry != NULL);
+
+	if(samePosition == TRUE) {
+	    // Keep a deeper result of the current search for the same position
+		if(HASH_AGE(oldData) == (table->age & 0xFF) && HASH_DEPTH(oldData) > depth && flags != HFEXACT) {
+			return;
+		}
+
+	    // Keep the old move if there is no new one
+		if(newMove == NOMOVE) {
+			newMove = HASH_MOVE(oldData);
+		}
+	}
+
+    // Adjust mate scores by the ply
+	if(score > ISMATE) {
+		score += pos->ply;
+	} else if(score < -ISMATE) {
+		score -= pos->ply;
+	}
+
+	data = HASH_DATA(newMove, score, depth, flags, table->age);
+
+	entry->data = data;
+	entry->smpKey = pos->posKey ^ data;
+}
+
+/**
+  * Function to probe the Hash table
   *
   * @param *pos Board position
-  * @param move Move to store
+  * @param *move Set to the stored move, if any
+  * @param *score Set to the stored score if it causes a cut-off
+  * @param alpha Alpha of the current search
+  * @param beta Beta of the current search
+  * @param depth Depth of the current search
+  * @return TRUE if the stored score can be used as a cut-off, FALSE otherwise
   */
-void StorePvMove(const S_BOARD *pos, const int move) {
-    // Get the index between 0 and number of entries
-	int index = pos->posKey % pos->PvTable->numEntries;
-	ASSERT(index >= 0 && index <= pos->PvTable->numEntries - 1);
-
-    // Store the move
-	pos->PvTable->pTable[index].move = move;
-	// Store the position key
-    pos->PvTable->pTable[index].posKey = pos->posKey;
+int ProbeHashEntry(S_BOARD *pos, int *move, int *score, int alpha, int beta, int depth) {
+	U64 data = 0ULL;
+
+	ASSERT(depth >= 0);
+	ASSERT(alpha < beta);
+	ASSERT(alpha >= -INFINITE && alpha <= INFINITE);
+	ASSERT(beta >= -INFINITE && beta <= INFINITE);
+	ASSERT(pos->ply >= 0 && pos->ply < MAXDEPTH);
+
+	if(FindHashEntry(pos->HashTable, pos->posKey, &data) == FALSE) {
+		return FALSE;
+	}
+
+	*move = HASH_MOVE(data);
+
+    // The stored result is only usable if it was searched at least as deep
+	if(HASH_DEPTH(data) < depth) {
+		return FALSE;
+	}
+
+	ASSERT(HASH_FLAGS(data) >= HFALPHA && HASH_FLAGS(data) <= HFEXACT);
+
+	*score = HASH_SCORE(data);
+
+    // Convert a mate score back to the distance from the root
+	if(*score > ISMATE) {
+		*score -= pos->ply;
+	} else if(*score < -ISMATE) {
+		*score += pos->ply;
+	}
+
+	switch(HASH_FLAGS(data)) {
+        // Upper bound: the real score is at most the stored one
+		case HFALPHA:
+			if(*score <= alpha) {
+				*score = alpha;
+				return TRUE;
+			}
+			break;
+        // Lower bound: the real score is at least the stored one
+		case HFBETA:
+			if(*score >= beta) {
+				*score = beta;
+				return TRUE;
+			}
+			break;
+		case HFEXACT:
+			return TRUE;
+		default: ASSERT(FALSE); break;
+	}
+
+	return FALSE;
 }
 
 /**
-  * Function to probe the Principal Variation table
+  * Function to probe the Hash table for the Principal Variation move
   *
   * @param *pos Board position
-  * @param move Move to store
+  * @return The stored move for the position, NOMOVE if none
   */
-int ProbePvTable(const S_BOARD *pos) {
-    // Get the index between 0 and number of entries
-	int index = pos->posKey % pos->PvTable->numEntries;
-	ASSERT(index >= 0 && index <= pos->PvTable->numEntries - 1);
-
-    // If the position key is same at this index, return the move as Principal Variation move
-	if(pos->PvTable->pTable[index].posKey == pos->posKey ) {
-		return pos->PvTable->pTable[index].move;
+int ProbePvMove(const S_BOARD *pos) {
+	U64 data = 0ULL;
+
+    // If the position is stored, return the move as Principal Variation move
+	if(FindHashEntry(pos->HashTable, pos->posKey, &data) == TRUE) {
+		return HASH_MOVE(data);
 	}
 
 	return NOMOVE;
 }
+
 /**
   * Function to get the Principal Variation line
-  * Returns the count of moves it managed to put into the PvTable
+  * Returns the count of moves it managed to put into the PvArray
   *
   * @param depth Current depth
   * @param *pos Board position
   */
 int GetPvLine(const int depth, S_BOARD *pos) {
 
-	ASSERT(depth < MAXDEPTH);
+	ASSERT(depth <= MAXDEPTH);
 
-    // Probe the PvTable
-	int move = ProbePvTable(pos);
+    // Probe the HashTable
+	int move = ProbePvMove(pos);
 	int count = 0;
 
     // Loop while a move exists
@@ -121,7 +407,7 @@ int GetPvLine(const int depth, S_BOARD *pos) {
 		}
 
 		// Probe the next move
-		move = ProbePvTable(pos);
+		move = ProbePvMove(pos);
 	}
 
     // Take back all the moves we made
@@ -10,9 +10,49 @@
 
 #include "defs.h"
 #include "stdio.h"
+#include "math.h"
+#include "string.h"
+
+// Depth reduction of the null move search
+#define NULL_MOVE_R 3
+// Initial half width of the aspiration window and the depth from which it is used
+#define ASPIRATION_WINDOW 25
+#define ASPIRATION_DEPTH 4
+// Beyond this width the window is opened fully on the failing side
+#define ASPIRATION_MAX 400
+// Depth up to which losing captures are skipped in the main search, and the loss allowed per ply
+#define SEE_PRUNE_DEPTH 3
+#define SEE_PRUNE_MARGIN 100
+// Bounds of the number of nodes between two checks of the time and the input, and the longest time between them
+#define CHECKUP_MIN_NODES 64
+#define CHECKUP_MAX_NODES 16384
+#define CHECKUP_MAX_MS 10
 
-#define INFINITE 30000
-#define MATE 29000
+/**
+  * Late move reductions by depth and by number of the move in the move ordering
+  */
+static int LmrReductions[MAXDEPTH][MAXPOSITIONMOVES];
+
+/**
+  * Function to initialize the late move reductions table
+  * The reduction grows with the logarithm of both the depth and the move number
+  *
+  */
+void InitSearch() {
+
+	int depth = 0;
+	int moveNum = 0;
+
+	for(depth = 0; depth < MAXDEPTH; ++depth) {
+		for(moveNum = 0; moveNum < MAXPOSITIONMOVES; ++moveNum) {
+			if(depth == 0 || moveNum == 0) {
+				LmrReductions[depth][moveNum] = 0;
+			} else {
+				LmrReductions[depth][moveNum] = (int) (0.75 + log(depth) * log(moveNum) / 2.25);
+			}
+		}
+	}
+}
 
 /***************** Algorithm **********************
 
@@ -92,40 +132,38 @@ int alphabeta(depth) {
   *
   */
 static void CheckUp(S_SEARCHINFO *info) {
-	// Check if time up, or interrupt from GUI
-	if(info->timeset == TRUE && GetTimeMs() > info->stoptime) {
-		info->stopped = TRUE;
+
+	U64 now = GetTimeMs();
+	U64 elapsed = now - info->lastCheckTime;
+	U64 nodes = info->nodes - info->lastCheckNodes;
+	U64 gap = CHECKUP_MAX_MS;
+	U64 interval = 0;
+
+	// Only the main thread listens to the protocol, helpers are stopped by the main thread
+	if(info->threadId == 0 && !info->ignoreInput) {
+		ReadInput(info);
 	}
 
-	ReadInput(info);
-}
+	// Check if time up, or interrupt from GUI. While pondering the clock isn't ours yet
+	if(info->timeset == TRUE && !info->ponder && now > info->stoptime) {
+		info->stopped = TRUE;
+	}
 
-/**
-  * Function to pick the next move to evaluate
-  *
-  * @param moveNum Move Number
-  * @param *list Pointer to the move list
-  */
-static void PickNextMove(int moveNum, S_MOVELIST *list) {
+	// Check again after about an eighth of the time left, at most CHECKUP_MAX_MS, at the speed of the last interval.
+	// Below the clock's resolution the speed is unknown, then the interval doubles.
+	if(info->timeset == TRUE && !info->ponder) {
+		gap = (now < info->stoptime) ? MAX(MIN((info->stoptime - now) / 8, gap), 1) : 1;
+	}
 
-	S_MOVE temp;
-	int index = 0;
-	int bestScore = 0;
-	int bestNum = moveNum;
-
-    // Loop from current move number to rest of the moves
-	for (index = moveNum; index < list->count; ++index) {
-        // If the score is best than the current best score
-		if (list->moves[index].score > bestScore) {
-			bestScore = list->moves[index].score;
-			bestNum = index;
-		}
+	if(elapsed > 0) {
+		interval = nodes * gap / elapsed;
+	} else {
+		interval = (U64) MAX(nodes, 1) * 2;
 	}
 
-    // Swap the better scoring move with the current one
-	temp = list->moves[moveNum];
-	list->moves[moveNum] = list->moves[bestNum];
-	list->moves[bestNum] = temp;
+	info->checkNodes = (int) MAX(MIN(interval, CHECKUP_MAX_NODES), CHECKUP_MIN_NODES);
+	info->lastCheckTime = now;
+	info->lastCheckNodes = info->nodes;
 }
 
 /**
@@ -176,8 +214,6 @@ static void ClearForSearch(S_BOARD *pos, S_SEARCHINFO *info) {
 		}
 	}
 
-    // Clear the Principal Variation Table
-	ClearPvTable(pos->PvTable);
 	// Reset the ply
 	pos->ply = 0;
 
@@ -185,14 +221,86 @@ static void ClearForSearch(S_BOARD *pos, S_SEARCHINFO *info) {
 	//info->starttime = GetTimeMs();
 	// Reset the Stopped flag
 	info->stopped = 0;
-	// Reset the number positions the engine has visited
+	// Reset the number positions the engine has visited, and check the time and input soon
 	info->nodes = 0;
+	info->checkNodes = CHECKUP_MIN_NODES;
+	info->lastCheckTime = GetTimeMs();
+	info->lastCheckNodes = 0;
 
     // Reset fail high and fail high first
 	info->fh = 0;
 	info->fhf = 0;
 }
 
+/**
+  * Function to get the move to ponder on after the best move from the Hash Table
+  *
+  * @param *pos Pointer to the board structure
+  * @param bestMove The best move
+  * @return The expected reply, NOMOVE if there is none
+  */
+static int GetPonderMove(S_BOARD *pos, const int bestMove) {
+
+	int move = NOMOVE;
+
+	MakeMove(pos, bestMove);
+	move = ProbePvMove(pos);
+
+	if(move != NOMOVE && !MoveIsLegal(pos, move)) {
+		move = NOMOVE;
+	}
+
+	TakeMove(pos);
+
+	return move;
+}
+
+/**
+  * Function to check if a root move is excluded from the MultiPV line being searched
+  *
+  * @param *info Pointer to the search info
+  * @param move The move
+  * @return TRUE if the move is the move of a line already found, FALSE otherwise
+  */
+static int IsExcludedMove(const S_SEARCHINFO *info, const int move) {
+
+	int index = 0;
+
+	for(index = 0; index < info->excludedNum; ++index) {
+		if(info->excludedMoves[index] == move) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+  * Function to get the first move to search at the root of a MultiPV line
+  * The moves of the last iteration's lines are tried in order, so every line shares the ordering of the lines
+  * before it instead of starting from the excluded hash move
+  *
+  * @param *info Pointer to the search info
+  * @param pvMove The hash move of the root
+  * @return The move to search first, NOMOVE if there is none
+  */
+static int RootHashMove(const S_SEARCHINFO *info, const int pvMove) {
+
+	int index = 0;
+
+	if(pvMove != NOMOVE && !IsExcludedMove(info, pvMove)) {
+		return pvMove;
+	}
+
+	for(index = 0; index < info->rootMoveNum; ++index) {
+		if(!IsExcludedMove(info, info->rootMoves[index])) {
+			return info->rootMoves[index];
+		}
+	}
+
+	return NOMOVE;
+}
+
 /**
   * Function for Quiescence search
   * Quiescence search in Wiki: http://en.wikipedia.org/wiki/Quiescence_search
@@ -205,8 +313,8 @@ static int Quiescence(int alpha, int beta, S_BOARD *pos, S_SEARCHINFO *info) {
 
 	ASSERT(CheckBoard(pos));
 
-    // Do we need to interrupt search: Ran out of time; GUI send interrupt. Check only after 2047 nodes
-	if((info->nodes & 2047 ) == 0) {
+    // Do we need to interrupt search: Ran out of time; GUI send interrupt. Checked every checkNodes nodes
+	if(--info->checkNodes <= 0) {
 		CheckUp(info);
 	}
 
@@ -224,8 +332,16 @@ static int Quiescence(int alpha, int beta, S_BOARD *pos, S_SEARCHINFO *info) {
 		return EvalPosition(pos);
 	}
 
+    // Probe the Hash Table for a cut-off
+	int pvMove = NOMOVE;
+	int score = -INFINITE;
+
+	if(ProbeHashEntry(pos, &pvMove, &score, alpha, beta, 0) == TRUE) {
+		return score;
+	}
+
     // Evaluate score without even making a move
-	int score = EvalPosition(pos);
+	score = EvalPosition(pos);
 
     // If our score is greater than or equal to beta return beta
 	if(score >= beta) {
@@ -237,25 +353,21 @@ static int Quiescence(int alpha, int beta, S_BOARD *pos, S_SEARCHINFO *info) {
 		alpha = score;
 	}
 
-	S_MOVELIST list[1];
-	// Generate all capture moves
-    GenerateAllCaps(pos, list);
+	// Pick the hash move (if it's a capture) and the captures that don't lose material
+	// by Static Exchange Evaluation; losing captures are pruned
+	S_MOVEPICKER picker[1];
+	InitMovePicker(picker, pos, pvMove, TRUE);
 
-    int moveNum = 0;
+	int move = NOMOVE;
 	int legal = 0;
 	int oldAlpha = alpha;
 	int bestMove = NOMOVE;
 	score = -INFINITE;
-	int pvMove = ProbePvTable(pos);
 
     // Loop through the moves
-	for(moveNum = 0; moveNum < list->count; ++moveNum) {
-
-		PickNextMove(moveNum, list);
+	while((move = NextMove(picker, pos)) != NOMOVE) {
 
-        if (!MakeMove(pos, list->moves[moveNum].move))  {
-            continue;
-        }
+        MakeMove(pos, move);
 
 		legal++;
 		score = -Quiescence(-beta, -alpha, pos, info);
@@ -272,16 +384,22 @@ static int Quiescence(int alpha, int beta, S_BOARD *pos, S_SEARCHINFO *info) {
 					info->fhf++;
 				}
 				info->fh++;
+
+				StoreHashEntry(pos, move, beta, HFBETA, 0);
+
 				return beta;
 			}
 
 			alpha = score;
-			bestMove = list->moves[moveNum].move;
+			bestMove = move;
 		}
     }
 
+    // Store the result in the Hash Table
 	if(alpha != oldAlpha) {
-		StorePvMove(pos, bestMove);
+		StoreHashEntry(pos, bestMove, alpha, HFEXACT, 0);
+	} else {
+		StoreHashEntry(pos, bestMove, alpha, HFALPHA, 0);
 	}
 
 	return alpha;
@@ -311,8 +429,8 @@ static int AlphaBeta(int alpha, int beta, int depth, S_BOARD *pos, S_SEARCHINFO
 		return Quiescence(alpha, beta, pos, info);
 	}
 
-    // Do we need to interrupt search: Ran out of time; GUI send interrupt. Check only after 2047 nodes
-	if(( info->nodes & 2047 ) == 0) {
+    // Do we need to interrupt search: Ran out of time; GUI send interrupt. Checked every checkNodes nodes
+	if(--info->checkNodes <= 0) {
 		CheckUp(info);
 	}
 
@@ -325,6 +443,11 @@ static int AlphaBeta(int alpha, int beta, int depth, S_BOARD *pos, S_SEARCHINFO
 		return 0;
 	}
 
+    // Neither side can mate: a draw, no need to search
+	if(pos->ply && MaterialDraw(pos)) {
+		return 0;
+	}
+
     // If the depth has reached its limit, return the evaluation of the current position
 	if(pos->ply > MAXDEPTH - 1) {
 		return EvalPosition(pos);
@@ -337,43 +460,107 @@ static int AlphaBeta(int alpha, int beta, int depth, S_BOARD *pos, S_SEARCHINFO
 		depth++;
 	}
 
-	S_MOVELIST list[1];
-	// Generate all moves
-    GenerateAllMoves(pos, list);
+	int score = -INFINITE;
+	int pvMove = NOMOVE;
+
+    // Probe the Hash Table. A stored result searched deep enough cuts the search off, except at the root
+	if(ProbeHashEntry(pos, &pvMove, &score, alpha, beta, depth) == TRUE && pos->ply) {
+		return score;
+	}
+
+    // MultiPV: the root's hash move may be the move of a line already found, start with the best move left instead
+	if(pos->ply == 0 && info->excludedNum > 0) {
+		pvMove = RootHashMove(info, pvMove);
+	}
+
+    // Null move pruning: pass the move and search with reduced depth; if the opponent still can't
+    // reach beta, the position is good enough to cut. Not in check, not twice in a row and not
+    // when the side to move has only pawns left (bigPce counts the king), where zugzwang is likely
+	if(DoNull && !inCheck && pos->ply && pos->bigPce[pos->side] > 1 && depth > NULL_MOVE_R) {
+		MakeNullMove(pos);
+		score = -AlphaBeta(-beta, -beta + 1, depth - 1 - NULL_MOVE_R, pos, info, FALSE);
+		TakeNullMove(pos);
+
+		if(info->stopped == TRUE) {
+			return 0;
+		}
+
+        // Don't trust a mate score found after passing a move
+		if(score >= beta && abs(score) < ISMATE) {
+			return beta;
+		}
+	}
+
+	// Pick the moves in stages: the hash move, captures, killers and quiet moves,
+	// generating each stage only when it's reached
+	S_MOVEPICKER picker[1];
+	InitMovePicker(picker, pos, pvMove, FALSE);
 
-    int moveNum = 0;
 	int legal = 0;
 	// Store the old alpha
 	int oldAlpha = alpha;
 	int bestMove = NOMOVE;
-	int score = -INFINITE;
-	int pvMove = ProbePvTable(pos);
+	int bestScore = -INFINITE;
 
-    // If a principal variations move is found update the score to 2000000
-	if(pvMove != NOMOVE) {
-		for(moveNum = 0; moveNum < list->count; ++moveNum) {
-			if( list->moves[moveNum].move == pvMove) {
-				list->moves[moveNum].score = 2000000;
-				break;
-			}
-		}
-	}
+	int move = NOMOVE;
+	int quiet = FALSE;
+	int reduction = 0;
 
     // Loop through the moves
-	for(moveNum = 0; moveNum < list->count; ++moveNum) {
+	while((move = NextMove(picker, pos)) != NOMOVE) {
 
-        // Pick the next move
-        PickNextMove(moveNum, list);
+        // MultiPV: the moves of the lines already found aren't searched again at the root
+        if(pos->ply == 0 && info->excludedNum > 0 && IsExcludedMove(info, move)) {
+            continue;
+        }
 
-        // Make the move
-        if (!MakeMove(pos, list->moves[moveNum].move))  {
+        // Quiet moves are neither captures, promotions nor killers, ordered by search history only
+        quiet = !(move & (MFLAGCAP | MFLAGPROM))
+                && move != pos->searchKillers[0][pos->ply]
+                && move != pos->searchKillers[1][pos->ply];
+
+        // Near the leaves skip captures that lose clearly more than a pawn per ply of depth left
+        if(!inCheck && legal > 0 && depth <= SEE_PRUNE_DEPTH && move != pvMove
+           && (move & MFLAGCAP) && PROMOTED(move) == EMPTY
+           && PieceVal[CAPTURED(move)] < PieceVal[pos->pieces[FROMSQ(move)]]
+           && StaticExchangeEval(pos, move) < -SEE_PRUNE_MARGIN * depth) {
             continue;
         }
 
-        // It's a legal move, increment the legal move count
+        // Make the move
+        MakeMove(pos, move);
+
+        // Increment the legal move count
 		legal++;
-		// Run alpha beta (as nega-max) with reduced depth
-		score = -AlphaBeta(-beta, -alpha, depth - 1, pos, info, TRUE);
+
+		if(legal == 1) {
+            // Principal variation search: the first move is searched with the full window
+			score = -AlphaBeta(-beta, -alpha, depth - 1, pos, info, TRUE);
+		} else {
+            // Late move reductions: quiet moves ordered late are searched less deep,
+            // unless we are in check or the move gives check
+			reduction = 0;
+
+			if(quiet && legal > 3 && depth >= 3 && !inCheck
+               && !SqAttacked(pos->kingSq[pos->side], pos->side^1, pos)) {
+				reduction = LmrReductions[MIN(depth, MAXDEPTH - 1)][MIN(legal, MAXPOSITIONMOVES - 1)];
+				reduction = MIN(reduction, depth - 2);
+			}
+
+            // Later moves are only proven to be worse than alpha with a zero window
+			score = -AlphaBeta(-alpha - 1, -alpha, depth - 1 - reduction, pos, info, TRUE);
+
+            // A reduced move that beats alpha is verified at full depth
+			if(score > alpha && reduction > 0) {
+				score = -AlphaBeta(-alpha - 1, -alpha, depth - 1, pos, info, TRUE);
+			}
+
+            // A move that falls inside the window is re-searched with the full window
+			if(score > alpha && score < beta) {
+				score = -AlphaBeta(-beta, -alpha, depth - 1, pos, info, TRUE);
+			}
+		}
+
 		// Take back the move
         TakeMove(pos);
 
@@ -382,8 +569,19 @@ static int AlphaBeta(int alpha, int beta, int depth, S_BOARD *pos, S_SEARCHINFO
 			return 0;
 		}
 
+        // Track the best move even if it does not raise alpha, for the Hash Table
+		if(score > bestScore) {
+			bestScore = score;
+			bestMove = move;
+		}
+
         // If it's alpha cut note the nest move and increase alpha
 		if(score > alpha) {
+            // At the root, note the move the search settled on
+            if(pos->ply == 0) {
+                info->rootBestMove = move;
+            }
+
             // If it's beta cut, return beta
 			if(score >= beta) {
 			    // For first legal move increment fail high first
@@ -396,22 +594,22 @@ static int AlphaBeta(int alpha, int beta, int depth, S_BOARD *pos, S_SEARCHINFO
 
                 // The move has a beta cut-off and not a capture
                 // Set the killer moves
-				if(!(list->moves[moveNum].move & MFLAGCAP)) {
+				if(!(move & MFLAGCAP)) {
 					pos->searchKillers[1][pos->ply] = pos->searchKillers[0][pos->ply];
-					pos->searchKillers[0][pos->ply] = list->moves[moveNum].move;
+					pos->searchKillers[0][pos->ply] = move;
 				}
 
+                // Store the lower bound in the Hash Table
+				StoreHashEntry(pos, bestMove, beta, HFBETA, depth);
+
 				return beta;
 			}
 
             // Set the new/improved alpha
 			alpha = score;
 
-			// Take the current move as the best move
-			bestMove = list->moves[moveNum].move;
-
             // For alpha cut-off update search history by prioritizing it by depth
-			if(!(list->moves[moveNum].move & MFLAGCAP)) {
+			if(!(move & MFLAGCAP)) {
 				pos->searchHistory[pos->pieces[FROMSQ(bestMove)]][TOSQ(bestMove)] += depth;
 			}
 		}
@@ -428,20 +626,235 @@ static int AlphaBeta(int alpha, int beta, int depth, S_BOARD *pos, S_SEARCHINFO
 		}
 	}
 
-    // If alpha has improved, store the best move as Principal Variation Move
+    // If alpha has improved, store the exact score with the best move as Principal Variation Move,
+    // otherwise store the upper bound
 	if(alpha != oldAlpha) {
-		StorePvMove(pos, bestMove);
+		StoreHashEntry(pos, bestMove, alpha, HFEXACT, depth);
+	} else {
+		StoreHashEntry(pos, bestMove, alpha, HFALPHA, depth);
 	}
 
     // Return alpha
 	return alpha;
 }
 
+/**
+  * Helper search threads, one less than the number of threads
+  */
+static S_SEARCHTHREAD *SearchThreads = NULL;
+static int NumHelpers = 0;
+
+/**
+  * Function to set the number of search threads
+  * Allocates the helper threads' boards; the main thread searches with the protocol's board
+  *
+  * @param *info Pointer to the search position structure
+  * @param threadNum Number of threads, including the main thread
+  */
+void SetSearchThreads(S_SEARCHINFO *info, int threadNum) {
+
+	if(threadNum < 1) {
+		threadNum = 1;
+	} else if(threadNum > MAX_THREADS) {
+		threadNum = MAX_THREADS;
+	}
+
+	free(SearchThreads);
+	SearchThreads = NULL;
+	NumHelpers = 0;
+
+	if(threadNum > 1) {
+		SearchThreads = (S_SEARCHTHREAD *) calloc(threadNum - 1, sizeof(S_SEARCHTHREAD));
+
+		if(SearchThreads == NULL) {
+			printf("Search threads allocation failed\n");
+			threadNum = 1;
+		} else {
+			NumHelpers = threadNum - 1;
+		}
+	}
+
+	info->threadNum = threadNum;
+}
+
+/**
+  * Function to clear the evaluation caches of the board and of the helper threads,
+  * needed when the evaluation itself changes, e.g. when a network is loaded
+  *
+  * @param *pos Pointer to the board structure of the main thread
+  */
+void ClearEvalTables(S_BOARD *pos) {
+
+	int index = 0;
+
+	if(pos->EvalTable != NULL) {
+		memset(pos->EvalTable, 0, sizeof(S_EVALTABLE));
+	}
+
+	for(index = 0; index < NumHelpers; ++index) {
+		memset(SearchThreads[index].evalTable, 0, sizeof(S_EVALTABLE));
+	}
+}
+
+/**
+  * Function for the search of a helper thread (Lazy SMP)
+  * Helpers run the same iterative deepening as the main thread without reporting anything.
+  * They share their results with the main thread through the Hash Table only.
+  *
+  * @param *arg Pointer to the S_SEARCHTHREAD of the helper
+  */
+static void *HelperSearch(void *arg) {
+
+	S_SEARCHTHREAD *thread = (S_SEARCHTHREAD *) arg;
+	int currentDepth = 0;
+
+	// Every other helper starts a ply deeper, so the threads spread over different depths
+	for(currentDepth = 1 + (thread->info->threadId & 1); currentDepth <= thread->info->depth; ++currentDepth) {
+		AlphaBeta(-INFINITE, INFINITE, currentDepth, thread->pos, thread->info, TRUE);
+
+		if(thread->info->stopped == TRUE) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+  * Function to start the helper threads on copies of the board
+  *
+  * @param *pos Pointer to the board structure
+  * @param *info Pointer to the search position structure
+  */
+static void StartHelperThreads(const S_BOARD *pos, const S_SEARCHINFO *info) {
+
+	int index = 0;
+	S_SEARCHTHREAD *thread = NULL;
+
+	for(index = 0; index < NumHelpers; ++index) {
+		thread = &SearchThreads[index];
+
+		// Own copy of the board and its heuristics; the Hash Table pointer is shared
+		*thread->pos = *pos;
+		thread->pos->PawnTable = thread->pawnTable;
+		thread->pos->MaterialTable = thread->materialTable;
+		thread->pos->EvalTable = thread->evalTable;
+		thread->pos->Accumulators = thread->accumulators;
+		NnueReset(thread->pos);
+		*thread->info = *info;
+		thread->info->threadId = index + 1;
+		ClearForSearch(thread->pos, thread->info);
+
+		if(pthread_create(&thread->handle, NULL, HelperSearch, thread) != 0) {
+			thread->info->stopped = TRUE;
+			thread->info->threadId = -1;
+		}
+	}
+}
+
+/**
+  * Function to stop the helper threads and wait for them to finish
+  *
+  */
+static void StopHelperThreads() {
+
+	int index = 0;
+
+	for(index = 0; index < NumHelpers; ++index) {
+		SearchThreads[index].info->stopped = TRUE;
+	}
+
+	for(index = 0; index < NumHelpers; ++index) {
+		if(SearchThreads[index].info->threadId != -1) {
+			pthread_join(SearchThreads[index].handle, NULL);
+		}
+	}
+}
+
+/**
+  * Function to get the nodes searched by all threads
+  *
+  * @param *info Pointer to the search position structure of the main thread
+  * @return Total number of nodes
+  */
+static U64 TotalNodes(const S_SEARCHINFO *info) {
+
+	int index = 0;
+	U64 nodes = info->nodes;
+
+	for(index = 0; index < NumHelpers; ++index) {
+		nodes += SearchThreads[index].info->nodes;
+	}
+
+	return nodes;
+}
+
+/**
+  * Function to print the start of an info line of the UCI protocol, with the number of the line in a MultiPV analysis
+  *
+  * @param *info Pointer to the search position structure
+  * @param lineNum Index of the line, from 0
+  */
+static void PrintInfoStart(const S_SEARCHINFO *info, const int lineNum) {
+	printf("info ");
+
+	if(info->multiPV > 1) {
+		printf("multipv %d ", lineNum + 1);
+	}
+}
+
+/**
+  * Function to print a line found by an iteration
+  *
+  * @param *info Pointer to the search position structure
+  * @param *line The line
+  * @param lineNum Index of the line, from 0
+  * @param depth Depth of the iteration
+  * @param hashFull Usage of the Hash Table in permill
+  */
+static void PrintSearchLine(const S_SEARCHINFO *info, const S_PVLINE *line, const int lineNum, const int depth,
+                            const int hashFull) {
+
+	int pvNum = 0;
+
+	// The line is printed in several parts; hold stdout so the input thread's 'readyok' can't land inside it
+	flockfile(stdout);
+
+	if(info->GAME_MODE == UCIMODE) {
+            PrintInfoStart(info, lineNum);
+            printf("score cp %d depth %d nodes %llu time %d hashfull %d ",
+                   line->score,depth,TotalNodes(info),(int) (GetTimeMs()-info->starttime),hashFull);
+	} else if(info->GAME_MODE == XBOARDMODE && info->POST_THINKING == TRUE) {
+            printf("%d %d %d %llu ",
+                   depth, line->score, (int) (GetTimeMs()-info->starttime)/10,TotalNodes(info));
+	} else if(info->POST_THINKING == TRUE) {
+            printf("score:%d depth:%d nodes:%llu time:%d(ms) ",
+                   line->score,depth,TotalNodes(info),(int) (GetTimeMs()-info->starttime));
+	}
+
+	if(info->GAME_MODE == UCIMODE || info->POST_THINKING == TRUE) {
+            printf("pv");
+
+            for(pvNum = 0; pvNum < line->pvMoves; ++pvNum) {
+                printf(" %s", PrMove(line->pv[pvNum]));
+            }
+
+            printf("\n");
+
+            //printf("Ordering:%.2f\n", (info->fhf / info->fh));
+	}
+
+	funlockfile(stdout);
+}
+
 /**
   * Function to search move.
   * Works with iterative deepening.
   * Iterative Deepening in Wiki: http://en.wikipedia.org/wiki/Iterative_deepening_depth-first_search
   * Iterative Deepening in Chess Programming Wikispace: https://chessprogramming.wikispaces.com/Iterative+Deepening
+  * With MultiPV each iteration searches the root once per line, excluding the moves of the lines found before.
+  * The lines share the Hash Table, the killers and the history, and each starts with the best move left from the
+  * last iteration, so the lines after the first are much cheaper than the first.
   *
   * @param *pos Pointer to the board structure
   * @param *info Pointer to the search position structure
@@ -451,62 +864,184 @@ void SearchPosition(S_BOARD *pos, S_SEARCHINFO *info) {
 	int bestMove = NOMOVE;
 	int bestScore = -INFINITE;
 	int currentDepth = 0;
-	int pvMoves = 0;
+	int ponderMove = NOMOVE;
 	int pvNum = 0;
-
+	int score = -INFINITE;
+	int alpha = -INFINITE;
+	int beta = INFINITE;
+	int window = ASPIRATION_WINDOW;
+	int lineNum = 0;
+	int lineCount = 1;
+	S_PVLINE lines[MAX_MULTIPV];
+	S_MOVELIST rootList[1];
+
+	// The caller's thread is the main thread; protocol lines taken so far don't stop this search
+	info->threadId = 0;
+	info->inputSeq = InputLastLine();
+	info->searching = TRUE;
 	ClearForSearch(pos, info);
 
+	// As many lines as asked for, but not more than the legal moves
+	GenerateAllMoves(pos, rootList);
+	lineCount = MAX(MIN(MIN(info->multiPV, MAX_MULTIPV), rootList->count), 1);
+	info->excludedNum = 0;
+	info->rootMoveNum = 0;
+
+	for(lineNum = 0; lineNum < lineCount; ++lineNum) {
+		lines[lineNum].score = -INFINITE;
+		lines[lineNum].pvMoves = 0;
+	}
+
+    // Age the Hash Table instead of clearing it, so results of the previous search are reused
+	pos->HashTable->age++;
+
+	// Start the helpers searching the same position
+	StartHelperThreads(pos, info);
+
 	// Do iterative deepening: search iteratively with increasing depth and do move probing to optimize the alpha beta
 	for(currentDepth = 1; currentDepth <= info->depth; ++currentDepth) {
-        // Call Alpha Beta to get the score up to the current depth
-		bestScore = AlphaBeta(-INFINITE, INFINITE, currentDepth, pos, info, TRUE);
+		for(lineNum = 0; lineNum < lineCount; ++lineNum) {
+			// Exclude the moves of the lines found in this iteration
+			info->excludedNum = lineNum;
+			info->rootBestMove = NOMOVE;
+
+            // Aspiration window: search a narrow window around the line's score in the previous iteration
+			window = ASPIRATION_WINDOW;
+
+			if(currentDepth >= ASPIRATION_DEPTH) {
+				alpha = MAX(lines[lineNum].score - window, -INFINITE);
+				beta = MIN(lines[lineNum].score + window, INFINITE);
+			} else {
+				alpha = -INFINITE;
+				beta = INFINITE;
+			}
+
+			while(TRUE) {
+                // Call Alpha Beta to get the score up to the current depth
+				score = AlphaBeta(alpha, beta, currentDepth, pos, info, TRUE);
+
+				if(info->stopped == TRUE) {
+					break;
+				}
+
+                // On a fail low or fail high widen the window on that side and search again
+				if(score <= alpha) {
+					if(info->GAME_MODE == UCIMODE) {
+						flockfile(stdout);
+						PrintInfoStart(info, lineNum);
+						printf("depth %d score cp %d upperbound nodes %llu time %d\n",
+                               currentDepth, score, TotalNodes(info), (int) (GetTimeMs()-info->starttime));
+						funlockfile(stdout);
+					}
+
+					alpha = (window >= ASPIRATION_MAX) ? -INFINITE : MAX(alpha - window, -INFINITE);
+				} else if(score >= beta) {
+					if(info->GAME_MODE == UCIMODE) {
+						flockfile(stdout);
+						PrintInfoStart(info, lineNum);
+						printf("depth %d score cp %d lowerbound nodes %llu time %d\n",
+                               currentDepth, score, TotalNodes(info), (int) (GetTimeMs()-info->starttime));
+						funlockfile(stdout);
+					}
+
+					beta = (window >= ASPIRATION_MAX) ? INFINITE : MIN(beta + window, INFINITE);
+				} else {
+					break;
+				}
+
+				window *= 2;
+			}
+
+			// If out of time or interrupted, break and return
+			if(info->stopped == TRUE) {
+				break;
+			}
+
+            // Get the Principal Variation of the line; its first move is excluded from the next lines
+			lines[lineNum].score = score;
+			lines[lineNum].pv[0] = NOMOVE;
+			lines[lineNum].pvMoves = GetPvLine(currentDepth, pos);
+
+			for(pvNum = 0; pvNum < lines[lineNum].pvMoves; ++pvNum) {
+				lines[lineNum].pv[pvNum] = pos->PvArray[pvNum];
+			}
+
+			// A helper may have overwritten the root's entry since, then only the root move is known
+			if(info->rootBestMove != NOMOVE
+               && (lines[lineNum].pvMoves == 0 || lines[lineNum].pv[0] != info->rootBestMove)) {
+				lines[lineNum].pv[0] = info->rootBestMove;
+				lines[lineNum].pvMoves = 1;
+			}
+
+			info->excludedMoves[lineNum] = info->rootBestMove;
+
+			// Get the first move of the first line as the best move, and the second as the move to ponder on
+			if(lineNum == 0) {
+				bestScore = score;
+				bestMove = lines[0].pv[0];
+				ponderMove = (lines[0].pvMoves > 1) ? lines[0].pv[1] : NOMOVE;
+			}
+
+			PrintSearchLine(info, &lines[lineNum], lineNum, currentDepth, HashFull(pos->HashTable));
+		}
+
+		info->excludedNum = 0;
+
+		// The searches of the other lines overwrote the root's entry, put the best move back for the next iteration
+		if(lineCount > 1 && lineNum > 0) {
+			StoreHashEntry(pos, bestMove, bestScore, HFEXACT, currentDepth);
+		}
 
-		// If out of time or interrupted, break and return
 		if(info->stopped == TRUE) {
 			break;
 		}
 
-        // Get the Principal Variation
-		pvMoves = GetPvLine(currentDepth, pos);
-		// Get the first move from the Principal Variation as the best move
-		bestMove = pos->PvArray[0];
-
-		if(info->GAME_MODE == UCIMODE) {
-                printf("info score cp %d depth %d nodes %ld time %d ",
-                       bestScore,currentDepth,info->nodes,GetTimeMs()-info->starttime);
-                /*printf("Depth:%d, score:%d, move:%s (%s), nodes:%ld, ",
-                       currentDepth, bestScore, PrMove(bestMove), PrAlgMove(bestMove, pos), info->nodes);*/
-		} else if(info->GAME_MODE == XBOARDMODE && info->POST_THINKING == TRUE) {
-                printf("%d %d %d %ld ",
-                       currentDepth, bestScore, (GetTimeMs()-info->starttime)/10,info->nodes);
-		} else if(info->POST_THINKING == TRUE) {
-                printf("score:%d depth:%d nodes:%ld time:%d(ms) ",
-                       bestScore,currentDepth,info->nodes,GetTimeMs()-info->starttime);
+		// The next iteration starts each line with the best move left, in the order of this iteration's lines
+		for(lineNum = 0; lineNum < lineCount; ++lineNum) {
+			info->rootMoves[lineNum] = lines[lineNum].pv[0];
 		}
 
-		if(info->GAME_MODE == UCIMODE || info->POST_THINKING == TRUE) {
-                pvMoves = GetPvLine(currentDepth, pos);
-                printf("pv");
+		info->rootMoveNum = lineCount;
 
-                for(pvNum = 0; pvNum < pvMoves; ++pvNum) {
-                    printf(" %s", PrMove(pos->PvArray[pvNum]));
-                }
+		// Stop if the best move is stable enough, or if the next iteration can't finish in time
+		if(StopAfterIteration(info, bestMove, bestScore)) {
+			break;
+		}
+	}
 
-                /*printf("Principal Variation:");
+	StopHelperThreads();
 
-                for(pvNum = 0; pvNum < pvMoves; ++pvNum) {
-                        printf(" %s (%s)", PrMove(pos->PvArray[pvNum]), PrAlgMove(pos->PvArray[pvNum], pos));
-                }*/
+	// A ponder search that finished its iterations may only answer after 'ponderhit' or 'stop'
+	if(info->ponder && !info->stopped) {
+		WaitPonderEnd(info);
+	}
 
-                printf("\n");
+	// Stopped before the first iteration completed: play the Hash Table's move, or any legal move
+	if(bestMove == NOMOVE) {
+		bestMove = ProbePvMove(pos);
 
-                //printf("Ordering:%.2f\n", (info->fhf / info->fh));
+		if(bestMove == NOMOVE || !MoveIsLegal(pos, bestMove)) {
+			S_MOVELIST list[1];
+			GenerateAllMoves(pos, list);
+			bestMove = (list->count > 0) ? list->moves[0].move : NOMOVE;
 		}
 	}
 
 	if(info->GAME_MODE == UCIMODE) {
             //info score cp 13  depth 1 nodes 13 time 15 pv f1b5
-            printf("bestmove %s\n", PrMove(bestMove));
+            // Suggest the reply to ponder on, from the Hash Table if the PV is cut short
+            if(ponderMove == NOMOVE && bestMove != NOMOVE) {
+                ponderMove = GetPonderMove(pos, bestMove);
+            }
+
+            if(ponderMove != NOMOVE) {
+                flockfile(stdout);
+                printf("bestmove %s", PrMove(bestMove));
+                printf(" ponder %s\n", PrMove(ponderMove));
+                funlockfile(stdout);
+            } else {
+                printf("bestmove %s\n", PrMove(bestMove));
+            }
             /*printf("bestmove %s (%s)\n",PrMove(bestMove), PrAlgMove(bestMove, pos));*/
 	} else if(info->GAME_MODE == XBOARDMODE) {
             printf("move %s\n", PrMove(bestMove));
@@ -516,6 +1051,9 @@ void SearchPosition(S_BOARD *pos, S_SEARCHINFO *info) {
             MakeMove(pos, bestMove);
             PrintBoard(pos);
 	}
+
+	info->searching = FALSE;
+	info->ponder = FALSE;
 }
 
 #endif // SEARCH_C
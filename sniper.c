@@ -10,14 +10,56 @@
 
 #include "stdio.h"
 #include "stdlib.h"
+#include "string.h"
 #include "defs.h"
 
+/**
+  * Function to run the perft suite command: perftsuite <file> <maxdepth> [threads]
+  *
+  * @param *args Arguments of the command
+  * @param *pos Pointer to the board structure
+  * @return Exit code, 0 if all counts match, 1 otherwise
+  */
+static int RunPerftSuite(const char *args, S_BOARD *pos) {
+
+    char fileName[256];
+    int maxDepth = 0;
+    int threadNum = 1;
+
+    if(sscanf(args, "%255s %d %d", fileName, &maxDepth, &threadNum) < 2) {
+        printf("Usage: perftsuite <file> <maxdepth> [threads]\n");
+        return 1;
+    }
+
+    return PerftSuite(fileName, maxDepth, pos, threadNum) ? 0 : 1;
+}
+
+/**
+  * Function to run the bench command: bench [depth] [hash]
+  *
+  * @param *args Arguments of the command
+  * @param *pos Pointer to the board structure
+  * @param *info Pointer to the search info
+  */
+static void RunBench(const char *args, S_BOARD *pos, S_SEARCHINFO *info) {
+
+    int depth = BENCH_DEPTH;
+    int MB = HASH_DEFAULT_MB;
+
+    sscanf(args, "%d %d", &depth, &MB);
+
+    Bench(pos, info, depth, MB);
+}
+
 /**
   * Entry point of the sniper engine
   *
+  * @param argc Number of command line arguments
+  * @param *argv Command line arguments; "perftsuite <file> <maxdepth> [threads]" runs the perft suite and exits,
+  * "bench [depth] [hash]" runs the bench and exits
   * @return Exit code of the sniper engine
   */
-int main()
+int main(int argc, char *argv[])
 {
     // Initialize sniper
     AllInit();
@@ -25,25 +67,60 @@ int main()
     S_BOARD pos[1];
     S_SEARCHINFO info[1];
 
-    // Initialize PV Table
-    InitPvTable(pos->PvTable);
+    // Initialize the board and its Hash Table
+    InitializeBoard(pos);
+
+    // Initialize the search info, searching with a single thread and a single line by default
+    memset(info, 0, sizeof(S_SEARCHINFO));
+    info->GAME_MODE = UCIMODE;
+    info->multiPV = 1;
+    SetSearchThreads(info, 1);
+
+    char line[256];
+    int exitCode = 0;
+
+    // Run the perft suite from the command line, e.g. as a move generator regression gate
+    if(argc > 1 && !strcmp(argv[1], "perftsuite")) {
+        if(argc < 4) {
+            printf("Usage: sniper perftsuite <file> <maxdepth> [threads]\n");
+            exitCode = 1;
+        } else {
+            exitCode = PerftSuite(argv[2], atoi(argv[3]), pos, (argc > 4) ? atoi(argv[4]) : 1) ? 0 : 1;
+        }
+
+        ClearBoard(pos);
+        free(HashTable->mem);
+
+        return exitCode;
+    }
+
+    // Run the bench from the command line
+    if(argc > 1 && !strcmp(argv[1], "bench")) {
+        Bench(pos, info, (argc > 2) ? atoi(argv[2]) : BENCH_DEPTH, (argc > 3) ? atoi(argv[3]) : HASH_DEFAULT_MB);
+
+        ClearBoard(pos);
+        free(HashTable->mem);
+
+        return 0;
+    }
 
     setbuf(stdin, NULL);
     setbuf(stdout, NULL);
 
+    // Read the protocol's commands on their own thread, so the search doesn't have to poll for them
+    StartInputThread(info);
+
     printf("Welcome to Sniper! Type 'sniper' for console mode...\n");
 
     // For unit testing
     // Test();
 
-    char line[256];
-
 	while (TRUE) {
 		memset(&line[0], 0, sizeof(line));
 
 		fflush(stdout);
-		if (!fgets(line, 256, stdin))
-			continue;
+		if (!GetInputLine(line, 256))
+			break;
 
 		if (line[0] == '\n')
 			continue;
@@ -61,15 +138,25 @@ int main()
 			Console_Loop(pos, info);
 			if(info->quit == TRUE) break;
 			continue;
+		} else if (!strncmp(line, "bench",5))	{
+		    // Run the bench: bench [depth] [hash]
+			RunBench(line + 5, pos, info);
+			continue;
+		} else if (!strncmp(line, "perftsuite",10))	{
+		    // Run the perft suite and exit with its result
+			exitCode = RunPerftSuite(line + 10, pos);
+			break;
 		} else if(!strncmp(line, "quit",4))	{
 			break;
 		}
 	}
 
-    // Free PV table
-    free(pos->PvTable->pTable);
+    ClearBoard(pos);
+
+    // Free Hash Table
+    free(HashTable->mem);
 
-    return 0;
+    return exitCode;
 }
 
 #endif // SNIPER_C
@@ -753,6 +753,50 @@ void TestGenerateBlackMoves() {
 	printf("\n\n==================== TestGenerateBlackMoves - End ====================\n\n");
 }
 
+/**
+  * Test the staged move picker: it must pick exactly the moves of the move generator
+  */
+void TestMovePicker() {
+    printf("\n\n==================== TestMovePicker - Start ====================\n\n");
+
+    S_BOARD board[1];
+    S_MOVELIST list[1];
+    S_MOVEPICKER picker[1];
+    InitializeBoard(board);
+
+    printf("\nTesting Move Picker...\n");
+
+	ParseFen(MOVEGENW,board);
+	PrintBoard(board);
+
+	GenerateAllMoves(board,list);
+
+	int move = NOMOVE;
+	int picked = 0;
+	int index = 0;
+	int found = FALSE;
+
+	InitMovePicker(picker, board, NOMOVE, FALSE);
+
+	while((move = NextMove(picker, board)) != NOMOVE) {
+        found = FALSE;
+
+        for(index = 0; index < list->count; ++index) {
+            if(list->moves[index].move == move) {
+                found = TRUE;
+            }
+        }
+
+        printf("Move %d (stage %d): %s%s\n", ++picked, picker->stage, PrMove(move), found ? "" : " NOT GENERATED");
+	}
+
+	printf("Picked %d moves, generated %d moves\n", picked, list->count);
+
+	ClearBoard(board);
+
+	printf("\n\n==================== TestMovePicker - End ====================\n\n");
+}
+
 /**
   * Test Make and Take moves
   */
@@ -781,9 +825,7 @@ void TestMakeAndTakeMoves() {
 
         printf("\nMaking move:%s (%s)\n", PrMove(move), PrAlgMove(move, board));
 
-		if(!MakeMove(board, move)) {
-			continue;
-		}
+		MakeMove(board, move);
 
 		printf("\nMade:%s (%s)\n", PrMove(move), PrAlgMove(move, board));
 		PrintBoard(board);
@@ -817,7 +859,7 @@ void RunPerftTest1() {
 	for(depth = 1; depth <= maxDepth; depth++) {
         ParseFen(START_FEN,board);
         printf("\nDepth: %d\n", depth);
-        PerftTest(depth, board);
+        PerftTest(depth, board, 1);
 	}
 
 	ClearBoard(board);
@@ -841,7 +883,7 @@ void RunPerftTest2() {
 	for(depth = 1; depth <= maxDepth; depth++) {
         ParseFen(PERFTFEN,board);
         printf("\nDepth: %d\n", depth);
-        PerftTest(depth, board);
+        PerftTest(depth, board, 1);
 	}
 
 	ClearBoard(board);
@@ -883,7 +925,7 @@ void TestParseAndSearchMoveFromUser(char* fen) {
             TakeMove(board);
         } else if(input[0] == 'p') {
             printf("\nRunning perft test (depth %d)\n", depth);
-			PerftTest(depth, board);
+			PerftTest(depth, board, 1);
 		} else if(input[0] == 'r') {
             printf("\nGetting PvLines (depth %d)\n", depth);
             max = GetPvLine(depth, board);
@@ -903,7 +945,7 @@ void TestParseAndSearchMoveFromUser(char* fen) {
 		} else {
             move = ParseMove(input, board);
             if(move != NOMOVE) {
-                StorePvMove(board, move);
+                StoreHashEntry(board, move, -INFINITE, HFALPHA, 0);
                 MakeMove(board, move);
                 /*if(IsRepetition(board)) {
                     printf("\nRepetition Detected\n");
@@ -959,7 +1001,7 @@ void TestParseAndSearchMove(char* fen, const char *inputs[], int numInputs, int
             TakeMove(board);
         } else if(currentInput[0] == 'p') {
             printf("\nRunning perft test (depth %d)\n", depth);
-			PerftTest(depth, board);
+			PerftTest(depth, board, 1);
 		} else if(currentInput[0] == 'r') {
             printf("\nGetting PvLines (depth %d)\n", depth);
             max = GetPvLine(depth, board);
@@ -979,7 +1021,7 @@ void TestParseAndSearchMove(char* fen, const char *inputs[], int numInputs, int
 		} else {
             move = ParseMove(currentInput, board);
             if(move != NOMOVE) {
-                StorePvMove(board, move);
+                StoreHashEntry(board, move, -INFINITE, HFALPHA, 0);
                 MakeMove(board, move);
                 /*if(IsRepetition(board)) {
                     printf("\nRepetition Detected\n");
@@ -1055,6 +1097,8 @@ void Test() {
 
     TestGenerateBlackMoves();
 
+    TestMovePicker();
+
     TestMakeAndTakeMoves();
 
     //RunPerftTest1();
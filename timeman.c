@@ -0,0 +1,132 @@
+/***********************************************************
+  * File Name: timeman.c
+  * Author: Somnath Mukherjee
+  * Description:
+  * Time manager: optimum and maximum time of a move
+  **********************************************************/
+
+#ifndef TIMEMAN_C
+#define TIMEMAN_C
+
+#include "defs.h"
+#include "stdio.h"
+
+/**
+  * Time kept for the protocol and the operating system on each move, in ms
+  */
+#define MOVE_OVERHEAD 30
+
+/**
+  * Moves expected until the end of a sudden death game, and the most moves to go we plan for
+  */
+#define TM_MOVES 40
+#define TM_MAX_MOVES 50
+
+/**
+  * The maximum time is at most TM_MAX_RATIO times the optimum time, and never more than 3/4 of the clock
+  */
+#define TM_MAX_RATIO 4
+
+/**
+  * Share of the optimum time in percent, by the number of iterations the best move has been stable:
+  * a best move that just changed gets more time, a stable one less
+  */
+static const int StabilityScale[] = { 140, 100, 90, 80, 70, 60, 50 };
+
+/**
+  * Fall of the score since the last iteration from which the time is extended, and the extension in percent
+  */
+#define TM_SCORE_DROP 30
+#define TM_SCORE_DROP_SCALE 40
+
+/**
+  * A new iteration isn't started after this share in percent of the time it may use: it would take longer than
+  * all the iterations before it, and would be stopped before it finishes
+  */
+#define TM_NEXT_ITERATION 55
+
+/**
+  * @brief Function to set the time limits of a search from the protocol's clock
+  * The hard limit, the maximum time, is the stop time checked during the search. The soft limit, the optimum time,
+  * is scaled by the stability of the best move after each iteration, see StopAfterIteration.
+  *
+  * @param *info Pointer to the search info, with its start time set
+  * @param time Time left on the clock in ms, -1 if not set
+  * @param inc Increment per move in ms
+  * @param movestogo Moves to the next time control, 0 for sudden death
+  * @param movetime Fixed time of the move in ms, -1 if not set
+  */
+void SetTimeLimits(S_SEARCHINFO *info, const int time, const int inc, const int movestogo, const int movetime) {
+
+	int timeLeft = 0;
+	int moves = 0;
+	int optimum = 0;
+	int maximum = 0;
+
+	info->timeset = FALSE;
+	info->optimumTime = 0ULL;
+	info->lastBestMove = NOMOVE;
+	info->stableIterations = 0;
+	info->lastScore = -INFINITE;
+
+	if(movetime != -1) {
+		// A fixed time is used completely
+		maximum = MAX(movetime - MOVE_OVERHEAD, 1);
+		optimum = 0;
+	} else if(time != -1) {
+		timeLeft = MAX(time - MOVE_OVERHEAD, 1);
+		moves = (movestogo > 0) ? MIN(movestogo, TM_MAX_MOVES) : TM_MOVES;
+
+		// An even share of the time left plus most of the increment, the rest of the increment builds up a reserve
+		maximum = timeLeft * 3 / 4;
+		optimum = MIN(timeLeft / moves + inc * 3 / 4, maximum);
+		maximum = MAX(MIN(optimum * TM_MAX_RATIO, maximum), 1);
+		optimum = MAX(optimum, 1);
+	} else {
+		return;
+	}
+
+	info->timeset = TRUE;
+	info->optimumTime = (U64) optimum;
+	info->stoptime = info->starttime + (U64) maximum;
+}
+
+/**
+  * @brief Function to decide after an iteration whether to start the next one
+  *
+  * @param *info Pointer to the search info
+  * @param bestMove Best move of the iteration
+  * @param score Score of the iteration
+  * @return TRUE if the search should stop, FALSE to start the next iteration
+  */
+int StopAfterIteration(S_SEARCHINFO *info, const int bestMove, const int score) {
+
+	U64 elapsed = GetTimeMs() - info->starttime;
+	U64 maximum = info->stoptime - info->starttime;
+	U64 target = 0ULL;
+	int scale = 0;
+	int count = (int) (sizeof(StabilityScale) / sizeof(StabilityScale[0]));
+
+	// Count the iterations with the same best move, and scale the optimum time by it and by the change of the score
+	info->stableIterations = (bestMove == info->lastBestMove) ? info->stableIterations + 1 : 0;
+	scale = StabilityScale[MIN(info->stableIterations, count - 1)];
+
+	if(info->lastScore != -INFINITE && score < info->lastScore - TM_SCORE_DROP) {
+		scale += TM_SCORE_DROP_SCALE;
+	}
+
+	info->lastBestMove = bestMove;
+	info->lastScore = score;
+
+	// While pondering, the search goes on until 'ponderhit' or 'stop'
+	if(info->timeset == FALSE || info->optimumTime == 0ULL || info->ponder) {
+		return FALSE;
+	}
+
+	target = MIN(info->optimumTime * (U64) scale / 100, maximum);
+
+	// Don't start an iteration that can't finish
+	return (elapsed * 100 >= target * TM_NEXT_ITERATION || elapsed * 2 >= maximum) ? TRUE : FALSE;
+}
+
+#endif // TIMEMAN_C
@@ -26,8 +26,8 @@ void ParseGo(char* line, S_SEARCHINFO *info, S_BOARD *pos) {
 
     // Depth
 	int depth = -1;
-	// Number of moves to reach time control
-	int movestogo = 30;
+	// Number of moves to reach time control, 0 for sudden death
+	int movestogo = 0;
 	// Move time
 	int movetime = -1;
 	// Time remaining
@@ -39,6 +39,9 @@ void ParseGo(char* line, S_SEARCHINFO *info, S_BOARD *pos) {
     // Assume that we are in infinite analysis mode
 	info->timeset = FALSE;
 
+    // Ponder on the opponent's expected move: the time limits only apply after 'ponderhit'
+	info->ponder = (strstr(line, "ponder") != NULL) ? TRUE : FALSE;
+
     // No need to do anything special if the 'infinite' command is received; as we are already in infinite analysis mode
 	if ((ptr = strstr(line,"infinite"))) {
 		;
@@ -79,36 +82,21 @@ void ParseGo(char* line, S_SEARCHINFO *info, S_BOARD *pos) {
 		depth = atoi(ptr + 6);
 	}
 
-    // If move time was specified, use the move time as time remaining and consider one move to go
-	if(movetime != -1) {
-		time = movetime;
-		movestogo = 1;
-	}
-
     // Set start time
 	info->starttime = GetTimeMs();
 	// Set depth
 	info->depth = depth;
 
-    // If time was set
-	if(time != -1) {
-        // Set the timeset flag
-		info->timeset = TRUE;
-        // Set how much time for this move
-		time /= movestogo;
-		// We don't want to overrun, so take 50 ms less
-		time -= 50;
-		// Stop time is Start Time + time for the move + increment
-		info->stoptime = info->starttime + time + inc;
-	}
+    // If time or move time was set, let the time manager set the optimum and the maximum time of the move
+	SetTimeLimits(info, time, inc, movestogo, movetime);
 
     // If depth is not set, set it to max depth
 	if(depth == -1) {
 		info->depth = MAXDEPTH;
 	}
 
-	printf("time:%d start:%d stop:%d depth:%d timeset:%d\n",
-		time,info->starttime, info->stoptime, info->depth, info->timeset);
+	printf("time:%d start:%llu optimum:%llu stop:%llu depth:%d timeset:%d\n",
+		time,info->starttime, info->optimumTime, info->stoptime, info->depth, info->timeset);
 
     // Call search position
 	SearchPosition(pos, info);
@@ -178,6 +166,82 @@ void ParsePosition(char* lineIn, S_BOARD *pos) {
 	PrintBoard(pos);
 }
 
+/**
+  * Function for printing the engine identity and options, answering the 'uci' command
+  *
+  */
+static void PrintUciId() {
+    printf("id name %s\n",NAME);
+    printf("id author %s\n", AUTHOR);
+    printf("option name Hash type spin default %d min %d max %d\n", HASH_DEFAULT_MB, HASH_MIN_MB, HASH_MAX_MB);
+    printf("option name Threads type spin default 1 min 1 max %d\n", MAX_THREADS);
+    printf("option name EvalFile type string default <empty>\n");
+    printf("option name Ponder type check default false\n");
+    printf("option name MultiPV type spin default 1 min 1 max %d\n", MAX_MULTIPV);
+    printf("uciok\n");
+}
+
+/**
+  * Function for Parsing an option
+  * setoption name Hash value 128
+  * setoption name Threads value 4
+  * setoption name EvalFile value nn.nnue
+  * setoption name Ponder value true
+  * setoption name MultiPV value 4
+  *
+  * @param *line Input Line
+  * @param *info Pointer to the search info
+  * @param *pos Pointer to the board structure
+  */
+void ParseSetOption(char* line, S_SEARCHINFO *info, S_BOARD *pos) {
+
+    char *ptr = NULL;
+    int MB = HASH_DEFAULT_MB;
+
+    // Hash Table size in MB; resizing clears the table
+    if ((ptr = strstr(line, "name Hash value "))) {
+        MB = atoi(ptr + 16);
+
+        if(MB < HASH_MIN_MB) {
+            MB = HASH_MIN_MB;
+        }
+
+        if(MB > HASH_MAX_MB) {
+            MB = HASH_MAX_MB;
+        }
+
+        printf("Set Hash to %d MB\n", MB);
+        InitHashTable(pos->HashTable, MB);
+    }
+
+    // Number of search threads, including the main thread
+    if ((ptr = strstr(line, "name Threads value "))) {
+        SetSearchThreads(info, atoi(ptr + 19));
+        printf("Set Threads to %d\n", info->threadNum);
+    }
+
+    // Number of lines of the analysis
+    if ((ptr = strstr(line, "name MultiPV value "))) {
+        info->multiPV = MAX(MIN(atoi(ptr + 19), MAX_MULTIPV), 1);
+        printf("Set MultiPV to %d\n", info->multiPV);
+    }
+
+    // NNUE network file; without one, or if it can't be loaded, the hand-written evaluation is used
+    if ((ptr = strstr(line, "name EvalFile value "))) {
+        ptr += 20;
+        ptr[strcspn(ptr, "\r\n")] = '\0';
+
+        if(*ptr == '\0' || !strcmp(ptr, "<empty>")) {
+            UnloadNnue();
+        } else {
+            LoadNnue(ptr);
+        }
+
+        // The cached evaluations are from the previous evaluation
+        ClearEvalTables(pos);
+    }
+}
+
 /**
   * Function for main UCI loop
   * https://ucichessengine.wordpress.com/2011/03/16/description-of-uci-protocol/
@@ -188,14 +252,11 @@ void ParsePosition(char* lineIn, S_BOARD *pos) {
   */
 void Uci_Loop(S_BOARD *pos, S_SEARCHINFO *info) {
 
-    // Set the input and output buffers to NULL
-	setbuf(stdin, NULL);
+    // Set the output buffer to NULL; the input is read by the input thread
     setbuf(stdout, NULL);
 
 	char line[INPUTBUFFER];
-    printf("id name %s\n",NAME);
-    printf("id author %s\n", AUTHOR);
-    printf("uciok\n");
+    PrintUciId();
 
 
     // Go in to infinite loop
@@ -203,8 +264,9 @@ void Uci_Loop(S_BOARD *pos, S_SEARCHINFO *info) {
 		memset(&line[0], 0, sizeof(line));
         fflush(stdout);
 
-        if (!fgets(line, INPUTBUFFER, stdin)) {
-            continue;
+        if (!GetInputLine(line, INPUTBUFFER)) {
+            info->quit = TRUE;
+            break;
         }
 
         if (line[0] == '\n') {
@@ -217,16 +279,20 @@ void Uci_Loop(S_BOARD *pos, S_SEARCHINFO *info) {
         } else if (!strncmp(line, "position", 8)) {
             ParsePosition(line, pos);
         } else if (!strncmp(line, "ucinewgame", 10)) {
+            ClearHashTable(pos->HashTable);
             ParsePosition("position startpos\n", pos);
         } else if (!strncmp(line, "go", 2)) {
             ParseGo(line, info, pos);
+        } else if (!strncmp(line, "setoption", 9)) {
+            ParseSetOption(line, info, pos);
+        } else if (!strncmp(line, "perft", 5)) {
+            // Non-standard: count the leaf nodes of the current position with the search threads
+            PerftTest(atoi(line + 5), pos, info->threadNum);
         } else if (!strncmp(line, "quit", 4)) {
             info->quit = TRUE;
             break;
         } else if (!strncmp(line, "uci", 3)) {
-            printf("id name %s\n",NAME);
-            printf("id author Somnath\n");
-            printf("uciok\n");
+            PrintUciId();
         }
 
         // Quit when quit signal is received
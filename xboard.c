@@ -84,21 +84,10 @@ int checkresult(S_BOARD *pos) {
     }
 
 	S_MOVELIST list[1];
+    // The move generator only generates legal moves
     GenerateAllMoves(pos,list);
 
-    int moveNum = 0;
-	int found = 0;
-	for(moveNum = 0; moveNum < list->count; ++moveNum) {
-
-        if ( !MakeMove(pos,list->moves[moveNum].move))  {
-            continue;
-        }
-        found++;
-		TakeMove(pos);
-		break;
-    }
-
-	if(found != 0) {
+	if(list->count != 0) {
             return FALSE;
 	}
 
@@ -140,7 +129,6 @@ void XBoard_Loop(S_BOARD *pos, S_SEARCHINFO *info) {
 
 	info->GAME_MODE = XBOARDMODE;
 	info->POST_THINKING = TRUE;
-	setbuf(stdin, NULL);
     setbuf(stdout, NULL);
 	PrintOptions(); // HACK
 
@@ -149,7 +137,7 @@ void XBoard_Loop(S_BOARD *pos, S_SEARCHINFO *info) {
 	int engineSide = BOTH;
 	int timeLeft;
 	int sec;
-	int mps;
+	int mps = 0;
 	int move = NOMOVE;
 	int i, score;
 	char inBuf[80], command[80];
@@ -167,18 +155,14 @@ void XBoard_Loop(S_BOARD *pos, S_SEARCHINFO *info) {
 			info->starttime = GetTimeMs();
 			info->depth = depth;
 
-			if(time != -1) {
-				info->timeset = TRUE;
-				time /= movestogo[pos->side];
-				time -= 50;
-				info->stoptime = info->starttime + time + inc;
-			}
+			// Let the time manager set the time of the move; the increment is in seconds
+			SetTimeLimits(info, time, inc * 1000, (mps != 0) ? movestogo[pos->side] : 0, (movetime != -1) ? movetime * 1000 : -1);
 
 			if(depth == -1 || depth > MAXDEPTH) {
 				info->depth = MAXDEPTH;
 			}
 
-			printf("time:%d start:%d stop:%d depth:%d timeset:%d movestogo:%d mps:%d\n",
+			printf("time:%d start:%llu stop:%llu depth:%d timeset:%d movestogo:%d mps:%d\n",
 				time,info->starttime,info->stoptime,info->depth,info->timeset, movestogo[pos->side], mps);
 				SearchPosition(pos, info);
 
@@ -195,8 +179,10 @@ void XBoard_Loop(S_BOARD *pos, S_SEARCHINFO *info) {
 
 		memset(&inBuf[0], 0, sizeof(inBuf));
 		fflush(stdout);
-		if (!fgets(inBuf, 80, stdin))
-		continue;
+		if (!GetInputLine(inBuf, 80)) {
+			info->quit = TRUE;
+			break;
+		}
 
 		sscanf(inBuf, "%s", command);
 
@@ -262,6 +248,7 @@ void XBoard_Loop(S_BOARD *pos, S_SEARCHINFO *info) {
 		}
 
 		if(!strcmp(command, "new")) {
+			ClearHashTable(pos->HashTable);
 			engineSide = BLACK;
 			ParseFen(START_FEN, pos);
 			depth = -1;
@@ -303,7 +290,6 @@ void Console_Loop(S_BOARD *pos, S_SEARCHINFO *info) {
 
 	info->GAME_MODE = CONSOLEMODE;
 	info->POST_THINKING = TRUE;
-	setbuf(stdin, NULL);
     setbuf(stdout, NULL);
 
 	int depth = MAXDEPTH, movetime = 3000;
@@ -322,10 +308,7 @@ void Console_Loop(S_BOARD *pos, S_SEARCHINFO *info) {
 			info->starttime = GetTimeMs();
 			info->depth = depth;
 
-			if(movetime != 0) {
-				info->timeset = TRUE;
-				info->stoptime = info->starttime + movetime;
-			}
+			SetTimeLimits(info, -1, 0, 0, (movetime != 0) ? movetime : -1);
 
 			SearchPosition(pos, info);
 		}
@@ -336,8 +319,10 @@ void Console_Loop(S_BOARD *pos, S_SEARCHINFO *info) {
 
 		memset(&inBuf[0], 0, sizeof(inBuf));
 		fflush(stdout);
-		if (!fgets(inBuf, 80, stdin))
-		continue;
+		if (!GetInputLine(inBuf, 80)) {
+			info->quit = TRUE;
+			break;
+		}
 
 		sscanf(inBuf, "%s", command);
 
@@ -406,6 +391,7 @@ void Console_Loop(S_BOARD *pos, S_SEARCHINFO *info) {
 		}
 
 		if(!strcmp(command, "new")) {
+			ClearHashTable(pos->HashTable);
 			engineSide = BLACK;
 			ParseFen(START_FEN, pos);
 			continue;